@@ -0,0 +1,86 @@
+#pragma once
+#include <boost/asio.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct redisAsyncContext;
+
+// 基于 hiredis 异步接口的 Redis 客户端，事件循环直接挂在服务器的 io_context 上。
+// 每个连接上的命令以流水线方式发送，不需要占用工作线程等待回复，
+// 在途命令数不再受连接池大小 × 工作线程数限制。
+// - 同一 shard 的命令总是走同一个连接，Redis 按发送顺序执行（同一玩家的写入不会乱序）
+// - 回调在 io 线程上执行，不要在回调里做阻塞操作
+// - 连接断开时在途命令以 DISCONNECTED 回复，之后自动重连
+// - 命令超过 timeout 未收到回复时以 TIMEOUT 回复（与同步客户端的 socket_timeout 对应）：
+//   回复按发送顺序到达，排在后面的命令也一并超时，连接断开重连，之后到达的回复丢弃
+class AsyncRedis
+{
+public:
+    struct Reply
+    {
+        enum Type
+        {
+            NIL,
+            STRING,
+            INTEGER,
+            ARRAY,
+            STATUS,
+            ERROR,
+            DISCONNECTED, // 连接不可用，命令未执行或结果未知
+            TIMEOUT       // 超时未收到回复，命令可能已执行
+        } type = NIL;
+        std::string str; // STRING/STATUS/ERROR 的内容
+        long long integer = 0;
+        std::vector<Reply> elements;
+
+        bool ok() const
+        {
+            return type != ERROR && type != DISCONNECTED && type != TIMEOUT;
+        }
+
+        // 失败原因，用于日志
+        std::string error() const
+        {
+            if (type == DISCONNECTED)
+                return "redis disconnected";
+            if (type == TIMEOUT)
+                return "redis timeout";
+            return str;
+        }
+    };
+    using Callback = std::function<void(Reply)>;
+
+    AsyncRedis(boost::asio::io_context &io, std::string host, int port, size_t connections = 4,
+               std::chrono::milliseconds timeout = std::chrono::milliseconds(200));
+    ~AsyncRedis();
+
+    // 建立所有连接（异步，不等待连接完成）
+    void start();
+
+    // 异步执行命令，完成后在 io 线程上回调
+    void command(size_t shard, std::vector<std::string> argv, Callback callback);
+    // 异步执行命令，返回 future
+    std::future<Reply> command(size_t shard, std::vector<std::string> argv);
+
+    // 已发送但尚未收到回复的命令数
+    size_t inflight() const
+    {
+        return inflight_;
+    }
+
+private:
+    class Connection;
+
+    boost::asio::io_context &io_;
+    std::string host_;
+    int port_;
+    std::chrono::milliseconds timeout_;
+    std::atomic<size_t> inflight_ = 0;
+    std::vector<std::unique_ptr<Connection>> connections_;
+};
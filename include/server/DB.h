@@ -2,14 +2,114 @@
 #define DB_H
 
 #include<mysql/mysql.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
 // 配置数据库信息
 static std::string server = "127.0.0.1";
 static std::string user = "root";
 static std::string password = "123456";
 static std::string dbname = "GameUser";
 
-// 数据库操作类
+// 连接池中的一个连接，以及在这个连接上已经准备好的语句（按 SQL 文本缓存）
+struct MySQLConnection
+{
+  MYSQL *conn = nullptr;
+  std::unordered_map<std::string, MYSQL_STMT *> statements;
+
+  // 先关闭语句再关闭连接
+  ~MySQLConnection();
+};
+
+// 数据库连接池：连接建立后复用，不再每次查询都做一次 TCP 握手 + 认证 + set names
+// - 连接数在 min_size 与 max_size 之间，用完时等待 checkout_timeout，超时取连接失败
+// - 空闲超过 ping_idle 的连接取出前先 mysql_ping，断开的连接关闭后重新建立
+// - 超过 min_size 的连接空闲 max_idle 后关闭
+// - 预处理语句缓存在连接上，连接重建后重新准备
+class MySQLPool
+{
+public:
+  struct Options
+  {
+    size_t min_size = 4;
+    size_t max_size = 32;
+    std::chrono::milliseconds checkout_timeout{2000};
+    std::chrono::seconds ping_idle{30};
+    std::chrono::seconds max_idle{300};
+  };
+
+  static MySQLPool &instance();
+  // 启动时调用：设置参数并预先建立 min_size 个连接
+  void configure(const Options &options);
+
+  // 取出一个可用连接，超时或建立连接失败返回 nullptr
+  MySQLConnection *acquire();
+  // 归还连接；broken 为 true 时关闭该连接（连接已断开或状态不可复用）
+  void release(MySQLConnection *conn, bool broken);
+
+  // 连接池运行指标
+  struct Stats
+  {
+    size_t total;      // 当前连接数（含借出的）
+    size_t idle;       // 空闲连接数
+    size_t created;    // 累计建立的连接数
+    size_t reconnects; // 健康检查失败后重建的次数
+    size_t waits;      // 取连接时需要等待的次数
+    size_t timeouts;   // 等待超时的次数
+  };
+  Stats stats();
+
+private:
+  MySQLPool();
+  ~MySQLPool();
+  // 建立一个新连接（不持有锁）
+  MySQLConnection *open();
+
+  struct Idle
+  {
+    MySQLConnection *conn;
+    std::chrono::steady_clock::time_point since;
+  };
+
+  std::mutex _mtx;
+  std::condition_variable _cv;
+  Options _options;
+  std::deque<Idle> _idle; // 尾部为最近归还的连接
+  size_t _total = 0;      // 已建立或正在建立的连接数
+  Stats _stats{};
+};
+
+// 预处理语句的参数或结果绑定，缓冲区由调用方提供，执行与读取期间保持有效
+class MySQLBinds
+{
+public:
+  explicit MySQLBinds(size_t count);
+  void setInt(size_t i, int *value);
+  void setFloat(size_t i, float *value);
+  // 字符串参数
+  void setString(size_t i, const std::string &value);
+  // 字符串结果，实际长度见 length
+  void setBuffer(size_t i, char *buffer, size_t capacity);
+  unsigned long length(size_t i) const;
+  bool isNull(size_t i) const;
+  MYSQL_BIND *data();
+
+private:
+  // MySQL 8 为 bool，5.7 为 my_bool
+  using NullFlag = std::remove_pointer_t<decltype(MYSQL_BIND::is_null)>;
+
+  std::vector<MYSQL_BIND> _binds;
+  std::vector<unsigned long> _lengths;
+  std::unique_ptr<NullFlag[]> _nulls;
+};
+
+// 数据库操作类：从连接池借出一个连接，析构时归还
 class MySQL
 {
 public:
@@ -26,8 +126,26 @@ public:
   //获取连接
   MYSQL* getConnection();
 
+  // 取当前连接上缓存的预处理语句，第一次使用时准备，失败返回 nullptr
+  MYSQL_STMT *prepare(const std::string &sql);
+  // 绑定参数并执行；results 非空时绑定结果并把结果集读到客户端，之后用 fetch 逐行读取
+  bool execute(MYSQL_STMT *stmt, MySQLBinds *params, MySQLBinds *results = nullptr);
+  // 读取下一行到结果绑定的缓冲区，没有更多行时返回 false
+  bool fetch(MYSQL_STMT *stmt);
+
+  // 事务：begin 关闭自动提交，commit/rollback 结束后恢复；未结束的事务在归还连接前回滚
+  bool begin();
+  bool commit();
+  void rollback();
+
 private:
+  // 执行失败后检查连接是否已断开，断开的连接不再归还给连接池
+  void checkBroken(unsigned int err);
+
+  MySQLConnection *_pooled;
   MYSQL *_conn;
+  bool _broken = false;
+  bool _transaction = false;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,98 @@
+#pragma once
+#include "SpillLog.h"
+
+#include <cppkafka/cppkafka.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// 异步 kafka 生产者：publish 只把消息放进 librdkafka 的发送队列就返回，不等待 broker 确认。
+// - 消息在客户端按 linger_ms / batch_messages 攒批发送
+// - 幂等生产者：失败由 librdkafka 在 message.timeout.ms 内自行重试，同一分区内不乱序、不重复
+// - 后台线程定期 poll，触发投递回调：成功计数；重试用尽仍失败的丢弃并计数
+//   （MySQL 的最终状态还有下线落盘与定时全量同步兜底）
+// - 配置 spill_dir 后不再丢弃：发送队列满、broker 不可用或投递失败的消息写入本地落盘队列（SpillLog），
+//   后台线程在 broker 恢复后回放；publish 始终不等待
+// - 顺序：key 相同的消息进入同一分区，直接发送的消息按 publish 的顺序到达（玩家事件以 uid 为 key）。
+//   落盘后回放的消息会晚于同一 key 之后发出的消息，消费端不能假设严格有序：
+//   同步 MySQL 时按 uid 读 Redis 最新状态，缓存重建按事件的 timestamp_ms/sequence 取最新值
+// - 析构时停止 poll 线程并在 flush_timeout 内尽量发完队列中的消息
+class KafkaPublisher
+{
+public:
+    struct Options
+    {
+        std::string brokers = "127.0.0.1:9092";
+        std::string topic;
+        int linger_ms = 5;              // 攒批等待时间（queue.buffering.max.ms）
+        int batch_messages = 1000;      // 单批最多消息数（batch.num.messages）
+        int queue_max_messages = 100000; // 发送队列上限，满时 publish 短暂等待后放弃
+        int message_timeout_ms = 30000; // 单条消息在客户端等待投递（含重试）的最长时间（message.timeout.ms）
+        std::chrono::milliseconds poll_interval{50};
+        std::chrono::milliseconds flush_timeout{5000};
+        // 本地落盘队列目录，为空时不落盘
+        std::string spill_dir;
+        std::chrono::milliseconds replay_interval{1000}; // 检查 broker 是否恢复并回放的间隔
+        // 其他 librdkafka 配置项（例如基准测试用的 test.mock.num.brokers）
+        std::vector<std::pair<std::string, std::string>> extra_config;
+    };
+
+    explicit KafkaPublisher(Options options);
+    ~KafkaPublisher();
+
+    // 放入发送队列，队列满且等待后仍满时返回 false；
+    // 配置了落盘队列时队列满或 broker 不可用直接落盘，落盘也失败（超过容量）才返回 false
+    // key 相同的消息进入同一分区，保持顺序（key 为空时不设置）
+    bool publish(const std::string &key, const std::string &payload);
+
+    // 生产者运行指标
+    struct Stats
+    {
+        size_t queued;    // 成功放入队列的消息数
+        size_t delivered; // broker 确认的消息数
+        size_t failed;    // 投递失败或入队失败而丢弃的消息数
+        size_t in_flight; // 仍在客户端队列中等待发送或确认的消息数
+        size_t spilled;     // 写入本地落盘队列的消息数
+        size_t replayed;    // 从落盘队列回放并确认的消息数
+        size_t spill_bytes; // 落盘队列中尚未回放的字节数
+        bool broker_down;   // 当前是否认为 broker 不可用
+    };
+    Stats stats() const;
+
+private:
+    // 投递回调（在 poll 线程上执行）
+    void on_delivery(const cppkafka::Message &message);
+    // 入队；wait 为 true 时队列满会 poll 一会儿等确认出队后再试
+    bool produce(const std::string &key, const std::string &payload, bool wait);
+    // 发不出去的消息：有落盘队列时落盘，否则丢弃并计数
+    bool spill(const std::string &key, const std::string &payload);
+    void poll_loop();
+    // 回放线程：broker 恢复后按段回放落盘队列
+    void replay_loop();
+    // broker 不可用时请求一次元数据，成功则认为已恢复
+    bool probe_broker();
+
+    Options options_;
+    // 落盘队列在生产者之后析构：析构时发送失败的消息仍可落盘
+    std::unique_ptr<SpillLog> spill_;
+    std::unique_ptr<cppkafka::Producer> producer_;
+    std::atomic<bool> stop_ = false;
+    std::atomic<bool> broker_down_ = false;
+    std::thread poll_thread_;
+    std::thread replay_thread_;
+    std::mutex replay_mtx_;
+    std::condition_variable replay_cv_;
+
+    std::atomic<size_t> queued_ = 0;
+    std::atomic<size_t> delivered_ = 0;
+    std::atomic<size_t> failed_ = 0;
+    std::atomic<size_t> spilled_ = 0;
+    std::atomic<size_t> replayed_ = 0;
+};
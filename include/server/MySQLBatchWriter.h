@@ -0,0 +1,71 @@
+#pragma once
+#include "protocol.pb.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// MySQL 组提交写入器：玩家状态的写入先进入队列，后台线程按时间间隔或数量阈值
+// 把一批玩家用多行 upsert 在一个事务里写入，高峰时 MySQL 的提交次数不再随写入次数增长。
+// - 同一批次内同一玩家只写最后一次提交的状态
+// - submit 的回调（或返回的 future）在这批写入提交后完成（true）或失败（false），
+//   回调在写入线程上执行，不要在里面做阻塞操作；工作线程上不要等待 future
+// - 失败不重试：Redis 仍是最新状态，由 kafka 同步与定时全量同步补写
+class MySQLBatchWriter
+{
+public:
+    struct Options
+    {
+        std::chrono::milliseconds interval{20}; // 最长攒批时间
+        size_t max_batch = 500;                 // 攒够这么多玩家立即写出
+        std::chrono::milliseconds report{10000}; // 统计日志间隔
+    };
+
+    explicit MySQLBatchWriter(Options options);
+    // 写完队列中剩余的玩家后返回
+    ~MySQLBatchWriter();
+
+    std::future<bool> submit(const msg::PlayerAttr &player);
+    void submit(const msg::PlayerAttr &player, std::function<void(bool)> done);
+
+    // 写出统计：批次大小与每批耗时（包含事务提交）
+    struct Stats
+    {
+        size_t submitted;      // 提交的写入次数
+        size_t flushes;        // 写出的批次数
+        size_t failed_flushes; // 失败的批次数
+        size_t rows;           // 写入的行数（合并后）
+        size_t last_rows;      // 最近一批的行数
+        size_t max_rows;       // 最大一批的行数
+        long long last_us;     // 最近一批耗时
+        long long max_us;      // 最长一批耗时
+        long long total_us;    // 累计耗时（除以 flushes 为平均耗时）
+        size_t pending;        // 队列中等待写出的玩家数
+    };
+    Stats stats();
+
+private:
+    // 一个玩家待写入的状态与等待它的调用方
+    struct Pending
+    {
+        msg::PlayerAttr player;
+        std::vector<std::function<void(bool)>> waiters;
+    };
+
+    void run();
+    void flush(std::unordered_map<int, Pending> &batch);
+
+    Options options_;
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::unordered_map<int, Pending> queue_;
+    bool stop_ = false;
+    Stats stats_{};
+    std::thread thread_;
+};
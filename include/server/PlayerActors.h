@@ -0,0 +1,120 @@
+#pragma once
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <unordered_map>
+#include <type_traits>
+#include <vector>
+#include <algorithm>
+
+#include "ThreadPool.h"
+
+// 玩家 actor：同一个 uid 的所有操作进入该玩家的邮箱，按顺序串行执行。
+// 邮箱只在有待处理消息时存在，处理完立即回收，内存只与在途的玩家数有关；
+// 邮箱表按 uid 分片，各分片独占缓存行，没有全局锁。不同玩家之间互不等待。
+// 在邮箱内不要同步 call 其他玩家（两个玩家互相 call 会互相等待），需要时用 post。
+// - call：同步调用，总是由调用线程（通常已是线程池工作线程）执行：先执行排在前面的消息
+//   （包括 post 已投递、处理任务还在线程池队列中的消息），再执行自己的操作。
+//   只有别的线程正在执行该邮箱时才等它让出；处理任务可能排在调用线程自己的队列里，在它上面等待会自己等自己
+// - post：异步投递，邮箱由线程池按 uid 调度处理
+// - post_async：异步投递一个发起异步 I/O 的操作，邮箱在 I/O 期间保持占用但不占用线程
+class PlayerActors
+{
+public:
+    PlayerActors();
+
+    // 绑定线程池，post 投递的消息在线程池上处理；未绑定时在调用线程处理
+    void bind(ThreadPool *pool)
+    {
+        pool_ = pool;
+    }
+
+    // 在 uid 的邮箱上串行执行 f，返回 f 的结果（异常会原样抛给调用方）
+    template <typename F>
+    auto call(int uid, F &&f) -> std::invoke_result_t<F>
+    {
+        // 当前线程正在处理该玩家的邮箱（操作内部嵌套调用），直接执行避免自己等自己
+        if (is_draining(uid))
+        {
+            return f();
+        }
+        // 占有邮箱后在当前线程执行，结束后顺带处理执行期间别人投递的消息
+        InlineGuard guard(*this, uid);
+        return f();
+    }
+
+    // 异步投递到 uid 的邮箱
+    void post(int uid, std::function<void()> func);
+
+    // 异步操作完成时调用，可以在任意线程调用，只能调用一次
+    using Done = std::function<void()>;
+    // 异步投递一个异步操作：f 在邮箱上执行并发起 I/O，I/O 完成后调用 done。
+    // done 之前邮箱保持占用，之后的消息排队等待（完成回调里可以直接读写该玩家的状态），
+    // 处理线程不等待，去处理其他玩家；期间 call 会等待 done。
+    // 在 call 顺带执行时（调用线程还要接着执行自己的操作）就地等待 done。
+    // 完成回调里不要 call 该玩家（自己等自己），需要时在 done 之后 post
+    void post_async(int uid, std::function<void(Done done)> f);
+
+    // 当前存在邮箱的玩家数
+    size_t size() const;
+
+    // 当前线程是否正在处理 uid 的邮箱
+    static bool is_draining(int uid);
+
+private:
+    struct Mailbox
+    {
+        std::vector<std::function<void()>> messages; // 处理时整批取走
+        bool running = false;                        // 是否已有线程正在处理该邮箱
+        bool scheduled = false;                      // 是否已向线程池投递了处理任务（尚未开始执行）
+        size_t waiters = 0;                          // 等待占有该邮箱的 call 数
+    };
+    // 分片降低锁竞争，每个分片独占缓存行，相邻分片的锁不会互相干扰
+    struct alignas(64) Shard
+    {
+        mutable std::mutex mtx;
+        std::condition_variable released; // 有 call 等待的邮箱被让出
+        std::unordered_map<int, Mailbox> mailboxes;
+    };
+    static constexpr size_t kShards = 64;
+
+    Shard &shard_of(int uid)
+    {
+        return shards_[static_cast<unsigned>(uid) % kShards];
+    }
+    // call 占有邮箱期间的守卫：构造时占有邮箱并执行排在前面的消息，析构时处理剩余消息并释放邮箱
+    struct InlineGuard
+    {
+        PlayerActors &actors;
+        int uid;
+        InlineGuard(PlayerActors &a, int u) : actors(a), uid(u)
+        {
+            actors.begin_inline(uid);
+        }
+        ~InlineGuard()
+        {
+            actors.end_inline(uid);
+        }
+    };
+    // 占有邮箱：有其他线程正在执行时等它让出
+    void acquire(int uid);
+    void begin_inline(int uid);
+    void end_inline(int uid);
+    // 投递消息，返回 true 表示没有线程正在处理，调用方需要负责处理该邮箱
+    bool push(int uid, std::function<void()> func);
+    // 线程池上的处理任务：邮箱已被其他线程接手时直接返回
+    void run_scheduled(int uid);
+    // 依次处理邮箱中的消息，处理完后回收邮箱；有 call 在等待时处理完当前一批即让出；
+    // 异步操作挂起邮箱时保持占用直接返回
+    void drain(int uid);
+    // 执行邮箱中已有的消息直到为空，不释放邮箱（调用方已占有）
+    void run_pending(int uid);
+    // 挂起邮箱的异步操作完成：释放邮箱，剩余消息交给线程池（同 post）
+    void resume(int uid);
+    // 按顺序执行一批消息，单条消息的异常只记录日志。
+    // can_suspend 时遇到挂起邮箱的异步操作即停止，batch 中只留下未执行的消息，返回 true
+    static bool run_batch(int uid, std::vector<std::function<void()>> &batch, bool can_suspend);
+
+    std::vector<Shard> shards_;
+    ThreadPool *pool_ = nullptr;
+};
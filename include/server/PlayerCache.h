@@ -0,0 +1,98 @@
+#pragma once
+#include "protocol.pb.h"
+
+#include <mutex>
+#include <list>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+// 进程内 L1 玩家缓存：在线玩家的 msg::PlayerAttr 常驻内存，读取不再经过 Redis。
+// 修改只落在内存并记录脏字段，由 PlayerDataManager 在玩家邮箱内定期或在下线时写回 Redis。
+// 按 uid 分片加锁；总内存按条目数估算，超出预算时按 LRU 淘汰干净条目。
+// 脏条目和正在写回的条目不淘汰（否则之后的加载可能从 Redis 读到旧数据），写回确认后才可淘汰，
+// 因此实际占用最多超出一个写回周期内被修改的玩家数。
+class PlayerCache
+{
+public:
+    // 玩家属性字段编号，同时作为脏标记的位
+    enum Field
+    {
+        LEVEL = 0,
+        EXP,
+        HP,
+        MP,
+        COIN,
+        X,
+        Y,
+        Z,
+        FIELD_COUNT
+    };
+
+    // 需要写回的玩家数据
+    struct Dirty
+    {
+        int uid;
+        msg::PlayerAttr attr;
+        uint32_t mask; // 脏字段位图
+    };
+
+    explicit PlayerCache(size_t budget_bytes);
+
+    // 命中时拷贝到 out 并刷新 LRU
+    bool get(int uid, msg::PlayerAttr &out);
+    // 放入干净数据（从 Redis/MySQL 加载），已存在则不覆盖内存中的修改
+    void put(const msg::PlayerAttr &attr);
+    // 修改已缓存玩家的字段并标脏，未命中返回 false
+    bool update(int uid, Field field, int value);
+    // 用 Redis 中已更新的经验与等级刷新缓存（不标脏），未命中返回 false
+    bool refreshExpAndLevel(int uid, int exp, int level);
+    // 有未写回修改的玩家
+    std::vector<int> dirtyUids() const;
+    // 取出玩家的脏数据快照并清除脏标记，没有修改返回 false（需在该玩家邮箱内调用）
+    // 成功取出后条目进入写回中状态，直到 writeDone
+    bool takeDirty(int uid, Dirty &out);
+    // 写回结束：failed_mask 为写回失败需要恢复的脏标记（玩家已不在 L1 时忽略）
+    void writeDone(int uid, uint32_t failed_mask);
+    // 移除玩家，若有未写回的修改则放入 out 并返回 true（下线写回）
+    bool remove(int uid, Dirty &out);
+
+    size_t size() const;
+
+    // 字段名与编号互转，未知字段返回 FIELD_COUNT
+    static Field fieldOf(const std::string &name);
+    static const char *fieldName(Field field);
+    // 按字段编号读写 PlayerAttr
+    static void setField(msg::PlayerAttr &attr, Field field, int value);
+    static std::string fieldValue(const msg::PlayerAttr &attr, Field field);
+    // 把 mask 中的字段从 src 拷贝到 dst
+    static void copyFields(msg::PlayerAttr &dst, const msg::PlayerAttr &src, uint32_t mask);
+
+private:
+    struct Entry
+    {
+        msg::PlayerAttr attr;
+        uint32_t dirty = 0;
+        uint32_t writing = 0; // 在途的写回次数
+    };
+    struct Shard
+    {
+        mutable std::mutex mtx;
+        std::list<int> lru; // 头部为最近使用
+        std::unordered_map<int, std::pair<Entry, std::list<int>::iterator>> entries;
+    };
+    static constexpr size_t kShards = 16;
+    // 淘汰时从 LRU 尾部最多检查的条目数
+    static constexpr size_t kEvictScan = 8;
+    // 单个条目的估算内存（属性 + 链表节点 + 哈希节点）
+    static constexpr size_t kEntryBytes = sizeof(Entry) + sizeof(int) * 2 + 64;
+
+    Shard &shard_of(int uid)
+    {
+        return shards_[static_cast<unsigned>(uid) % kShards];
+    }
+
+    std::vector<Shard> shards_;
+    size_t capacity_per_shard_;
+};
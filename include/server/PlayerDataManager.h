@@ -3,12 +3,25 @@
 #include "protocol.pb.h"
 #include "GameUser.h"
 #include "UserDatamodel.h"
+#include "PlayerActors.h"
+#include "PlayerCache.h"
+#include "RedisBatcher.h"
+#include "PlayerRecord.h"
+#include "PlayerLoader.h"
+#include "AsyncRedis.h"
+#include "PlayerScripts.h"
+#include "UidFilter.h"
+#include "KafkaPublisher.h"
+#include "ThreadPool.h"
+#include "MySQLBatchWriter.h"
 
 #include <sw/redis++/redis++.h>
 #include <memory>
 #include <string>
 #include <unordered_map>
 #include <cppkafka/cppkafka.h>
+#include <condition_variable>
+#include <thread>
 #include<unordered_map>
 
 class PlayerDataManager
@@ -16,34 +29,190 @@ class PlayerDataManager
 public:
     static PlayerDataManager &getInstance();
 
+    // 绑定工作线程池，玩家邮箱的异步消息在线程池上处理
+    void bindWorkerPool(ThreadPool &pool);
+    // 解除线程池绑定（线程池析构后调用），之后的邮箱消息在投递线程上处理
+    void unbindWorkerPool();
+    // 设置 Redis 中玩家记录的存储格式（默认 HASH）
+    void setRedisFormat(RedisFormat format);
+    // 绑定异步 Redis 客户端：写回、加经验与 getPlayerAsync 不再阻塞工作线程；传 nullptr 解除绑定（客户端析构前）
+    void bindAsyncRedis(AsyncRedis *async_redis);
+    // 把玩家数据的 Lua 脚本加载到 Redis（启动时调用，失败时退回 EVAL）
+    void loadScripts();
+    // 从 MySQL 加载全部已注册 uid 构建过滤器（启动时调用），之后不存在的 uid 不再产生 I/O
+    void loadKnownUids();
+    // 新注册/确认存在的 uid（注册、登录、建号时调用）
+    void addKnownUid(int uid);
+
     // 玩家登录获取数据
     std::shared_ptr<msg::PlayerAttr> loadPlayerData(int uid);
+    // 登录成功后异步预取玩家数据到 Redis 与 L1（同一玩家只有一个在途预取）
+    void prefetchPlayer(int uid);
+    // 玩家断开连接：尚未开始的预取不再执行
+    void cancelPrefetch(int uid);
     // 获取玩家数据
     std::shared_ptr<msg::PlayerAttr> getPlayer(int uid);
+    // 异步获取玩家数据：L1 命中时在调用线程直接回调，否则在读取完成后于 io 线程或该玩家的邮箱里回调（不存在时参数为空）
+    void getPlayerAsync(int uid, std::function<void(std::shared_ptr<msg::PlayerAttr>)> done);
     // 更新属性
     void updatePlayerAttr(int uid, const std::string &field, int value);
     //批量从redis中获取玩家数据
     void batchLoadFromRedis(const std::vector<int> &uids, std::unordered_map<int, msg::PlayerAttr> &out);
     //批量从mysql中获取数据并且加入到redis中
     void batchLoadFromMySQL(const std::vector<int> &uids, std::unordered_map<int, msg::PlayerAttr> &out);
-    // 经验增加更新函数
-    void updateExepAndLevel(int uid, int addexep, int &new_level, int &new_exp, bool &leveled_up);
+    // 经验增加的结果
+    struct ExpResult
+    {
+        bool ok = false; // 玩家不存在或 Redis 出错时为 false
+        int level = 0;
+        int exp = 0;
+        bool leveled_up = false;
+    };
+    // 经验增加更新函数：异步执行，不占用工作线程等待 Redis；done 在该玩家的邮箱释放后调用（io 线程或工作线程）
+    void updateExepAndLevel(int uid, int addexep, std::function<void(const ExpResult &)> done);
     // 同步redis-》mysql
-    void syncToMySQL(int uid, const std::string &field, int value);
-    // 定时全量同步
-    void syncAll();
-    // 玩家下线
+    // 批量同步：一次读出这些玩家在 Redis 中的最新状态，用一条多行 upsert 写入 MySQL
+    bool syncToMySQL(const std::vector<int> &uids);
+    // 定时全量同步：在独立的后台线程中分批把 Redis 里的所有玩家写入 MySQL，不占用工作线程
+    // 已在运行时不重复启动，返回是否启动了新的一轮
+    bool syncAll();
+    // 全量同步进度（最近一轮或正在进行的一轮）
+    struct SyncAllStats
+    {
+        bool running;          // 是否正在运行
+        size_t scanned_keys;   // 已扫描的 key 数（SCAN 可能重复返回）
+        size_t written_rows;   // 已写入 MySQL 的行数
+        size_t failed_rows;    // 读取或写入失败的行数
+        size_t completed_runs; // 累计完成的轮数
+        long long elapsed_ms;  // 本轮已用时间
+    };
+    SyncAllStats syncAllStats() const;
+    // 缓存重建：Redis 清空或故障切换后、开始接受连接之前调用（阻塞直到完成）。
+    // 以 MySQL 全表为快照，叠加 kafka 中保留的玩家变化事件（事件只带变化的字段），
+    // 分页交给多个线程以 pipeline 写入 Redis，避免上线后所有访问同时落到 MySQL
+    struct RebuildOptions
+    {
+        std::string brokers = "127.0.0.1:9092";
+        std::string topic = "playerdata_update";
+        bool replay_log = true;                 // 为 false 时只用 MySQL 快照
+        size_t writers = 4;                     // 写 Redis 的线程数
+        int page_size = 1000;                   // 每页（每个 pipeline）的玩家数
+        std::chrono::seconds ttl{3600};         // 重建记录的过期时间，0 为不过期；之后被修改的记录不再过期
+    };
+    struct RebuildStats
+    {
+        bool ok;                // MySQL 快照完整读完且全部写入
+        size_t snapshot_rows;   // 从 MySQL 读取的玩家数
+        size_t log_events;      // 回放的事件数
+        size_t log_players;     // 事件涉及的玩家数
+        size_t written;         // 写入 Redis 的玩家数
+        size_t failed;          // 写入失败的玩家数
+        long long elapsed_ms;
+        double players_per_sec; // 重建速率
+    };
+    RebuildStats rebuildCache(const RebuildOptions &options);
+    // 下线落盘的组提交统计（每批行数与耗时）
+    MySQLBatchWriter::Stats mysqlWriterStats();
+    // 玩家下线：异步落盘（写回 L1 中的修改并写入 MySQL），不等待 MySQL 提交
     void playerLogout(int uid);
 
 private:
     PlayerDataManager();
+    ~PlayerDataManager();
+
+    // 定期写回 L1 中的脏数据
+    void flushDirtyPlayers();
+    // 增量刷新已知 uid，补上其他服务器进程新注册的玩家
+    void refreshKnownUids();
+    // 全量同步一轮（在后台线程上执行）
+    void runSyncAll();
+    // 把一个玩家的修改写回 Redis 并推送 kafka（需在该玩家邮箱内调用）
+    // wait 为 true 时等待确认并返回是否写入成功（失败时脏标记已恢复）
+    bool writeBack(const PlayerCache::Dirty &dirty, bool wait);
+    // 同上，不阻塞：写入确认后以是否成功调用 done（异步路径在 io 线程上，同步路径就地调用）
+    void writeBack(const PlayerCache::Dirty &dirty, std::function<void(bool)> done);
+    void publishDirty(const PlayerCache::Dirty &dirty);
+    // 同步加经验（在玩家邮箱内调用），Redis 中不存在时先加载玩家
+    ExpResult addExp(int uid, int addexep);
+    // 执行加经验脚本，玩家在 Redis 中不存在时返回 false
+    bool runAddExp(int uid, int addexep, int &level, int &exp, bool &leveled_up);
+    // 推送加经验的变化事件并记录日志
+    void publishExp(int uid, const ExpResult &result);
+    // 执行 Lua 脚本：优先 EVALSHA，脚本未缓存（NOSCRIPT）时退回 EVAL
+    template <typename Run>
+    void runScript(PlayerScripts::Id id, Run run);
+    void evalAsync(AsyncRedis &async_redis, int uid, PlayerScripts::Id id, const std::string &key,
+                   const std::vector<std::string> &args, AsyncRedis::Callback done);
+    AsyncRedis::Reply evalAsync(AsyncRedis &async_redis, int uid, PlayerScripts::Id id,
+                                const std::string &key, const std::vector<std::string> &args);
+    std::string scriptSha(PlayerScripts::Id id);
+    static bool isNoScript(const std::string &error);
+    // EVALSHA 返回 NOSCRIPT：清掉缓存的 SHA1 并重新加载脚本
+    void scriptMissing(int uid, PlayerScripts::Id id, const std::string &sha);
+    // 下线写回确认后移出 L1 并提交 MySQL，完成后释放玩家邮箱
+    void flushLogout(int uid, std::shared_ptr<msg::PlayerAttr> player, bool cached, PlayerActors::Done release);
+    // 下线落盘后设置 Redis 记录的过期时间，完成后释放玩家邮箱
+    void expireAfterLogout(int uid, PlayerActors::Done release);
+    // 推送一个玩家的变化事件到 kafka（mask 为变化字段位图，attr 中对应字段为新值）
+    void publishEvent(int uid, uint32_t mask, const msg::PlayerAttr &attr);
+    // 按当前存储格式读写 Redis 中的玩家记录
+    bool readRecord(int uid, msg::PlayerAttr &out);
+    // 在玩家邮箱里把批量加载的记录放进 L1，logouts 为读取前的下线计数
+    void cacheLoaded(const msg::PlayerAttr &playerdata, uint64_t logouts);
+    // 异步读取一个玩家的记录，回调在 io 线程上执行
+    enum class ReadResult
+    {
+        FOUND,
+        MISSING,
+        FAILED,  // Redis 出错或超时
+        CORRUPT, // 记录无法解析
+    };
+    void readRecordAsync(AsyncRedis &async_redis, int uid, std::function<void(ReadResult, const msg::PlayerAttr &)> done);
+    std::vector<bool> readRecords(const std::vector<int> &uids, std::vector<msg::PlayerAttr> &out);
+    void writeRecords(const std::vector<const msg::PlayerAttr *> &players);
+    // 直接以一个 pipeline 写入一批玩家记录（不经过批量层）：ttl 为 0 时不过期；
+    // if_absent 为 true 时只写 Redis 中不存在的记录（回填），否则整条覆盖（缓存重建）
+    void fillRecords(const std::vector<msg::PlayerAttr> &players, std::chrono::seconds ttl, bool if_absent);
 
     std::shared_ptr<sw::redis::Redis> redis_;
+    // 批量访问层：合并并发请求到同一个 pipeline
+    std::unique_ptr<RedisBatcher> batcher_;
+    std::atomic<RedisFormat> format_ = RedisFormat::HASH;
+    // 异步客户端（可选，未绑定时走同步路径）
+    std::atomic<AsyncRedis *> async_redis_ = nullptr;
+    // 已加载脚本的 SHA1，为空表示未加载
+    std::mutex script_mtx_;
+    std::string script_sha_[PlayerScripts::SCRIPT_COUNT];
+
+    // kafka 异步生产者（攒批发送，不等待确认）
+    std::unique_ptr<KafkaPublisher> publisher_;
+    std::atomic<uint64_t> event_seq_ = 0;
+    // 下线落盘的 MySQL 组提交写入器
+    std::unique_ptr<MySQLBatchWriter> mysql_writer_;
 
-    // kafka
-    std::shared_ptr<cppkafka::Producer> producer_; // 生产者模型 用于写队列。
-    std::string topic_;
+    // 玩家 actor 邮箱：同一 uid 的所有操作串行执行
+    PlayerActors actors_;
+    // 在线玩家的进程内 L1 缓存（写回）
+    PlayerCache cache_;
+    std::atomic<uint64_t> logout_seq_ = 0; // 移出 L1 的下线次数
+    // 已知 uid 过滤器（Bloom + 负缓存）
+    UidFilter known_uids_;
+    std::atomic<int> refresh_cursor_ = 0; // 已加载到的最大 uid
+    // 在途的登录预取，值为取消标记
+    std::mutex prefetch_mtx_;
+    std::unordered_map<int, std::shared_ptr<std::atomic<bool>>> prefetches_;
+    // L1 未命中时的加载，合并同一玩家的并发加载（single-flight）
+    PlayerLoader loader_{actors_, cache_};
 
-    std::mutex mtx_map_; // 保护 player_mutex_map_ 的访问
-    std::unordered_map<int, std::shared_ptr<std::mutex>> player_mutex_map_;
+    // 全量同步后台线程与进度
+    std::thread sync_thread_;
+    std::mutex sync_mtx_;
+    std::condition_variable sync_cv_; // 限速等待，析构时唤醒
+    std::atomic<bool> sync_running_ = false;
+    std::atomic<bool> sync_stop_ = false;
+    std::atomic<size_t> sync_scanned_ = 0;
+    std::atomic<size_t> sync_written_ = 0;
+    std::atomic<size_t> sync_failed_ = 0;
+    std::atomic<size_t> sync_runs_ = 0;
+    std::atomic<long long> sync_elapsed_ms_ = 0;
 };
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+#include "protocol.pb.h"
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string>
+
+// kafka 中玩家变化事件（PlayerUpdateEvent）的回放：从各分区最早保留的位置读到开始时的最新位置，
+// 之后新产生的事件不读。不加入消费组、不提交 offset，不影响 PlayerSyncConsumer 的消费进度。
+// 同一玩家的事件在同一分区内，回调按产生顺序收到。
+class PlayerEventLog
+{
+public:
+    struct Options
+    {
+        std::string brokers = "127.0.0.1:9092";
+        std::string topic = "playerdata_update";
+        size_t poll_batch = 1000;
+        std::chrono::milliseconds timeout{10000}; // 连续这么久没有读到消息视为失败
+    };
+
+    struct Stats
+    {
+        size_t partitions; // 有数据的分区数
+        size_t events;     // 回放的事件数
+        size_t invalid;    // 无法解析的消息数
+    };
+
+    using Handler = std::function<void(const msg::PlayerUpdateEvent &event)>;
+
+    // 回放失败（连不上 broker、读取超时）时返回 false，已回调的事件不撤销
+    static bool replay(const Options &options, const Handler &handler, Stats *stats = nullptr);
+};
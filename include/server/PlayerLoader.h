@@ -0,0 +1,32 @@
+#pragma once
+#include "protocol.pb.h"
+#include "PlayerActors.h"
+#include "PlayerCache.h"
+#include "SingleFlight.h"
+
+#include <functional>
+#include <memory>
+
+// L1 未命中时的玩家加载：同一 uid 的并发调用只执行一次 load（single-flight），其余调用方等待并共享结果。
+// load 在玩家邮箱上执行，排队期间已被其他操作放入 L1 时直接返回 L1 中的数据，不再调用 load。
+// 结果的缓存由 load 负责（放入 L1/回填 Redis）；每个调用方拿到独立的副本。
+class PlayerLoader
+{
+public:
+    using Player = std::shared_ptr<msg::PlayerAttr>;
+
+    PlayerLoader(PlayerActors &actors, PlayerCache &cache);
+
+    Player loadOnce(int uid, const std::function<Player()> &load);
+
+    // 正在加载的玩家数
+    size_t inflight() const
+    {
+        return loads_.inflight();
+    }
+
+private:
+    PlayerActors &actors_;
+    PlayerCache &cache_;
+    SingleFlight<int, Player> loads_;
+};
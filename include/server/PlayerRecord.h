@@ -0,0 +1,44 @@
+#pragma once
+#include "protocol.pb.h"
+#include "PlayerCache.h"
+
+#include <string>
+#include <unordered_map>
+
+// Redis 中玩家记录的存储格式
+enum class RedisFormat
+{
+    HASH,    // 旧格式：hash，每个字段一个十进制字符串
+    MIGRATE, // 迁移模式：读两种格式，写二进制；读取不改写，旧 hash 在该玩家下一次写入时变为二进制
+    BINARY   // 只读写二进制
+};
+
+// 玩家记录的编解码。
+// 二进制格式为定长小端布局（33 字节）：
+//   [0]     版本号 kVersion
+//   [1,21)  level exp hp mp coin   int32
+//   [21,33) x y z                  float32
+// 与 Lua 的 struct.pack("<Biiiiifff", ...) 一致，服务端脚本可以直接解析。
+// 部分更新：字段位置固定，单个字段可用 SETRANGE key fieldOffset(f) <4 字节> 原子改写，
+// 多字段的读改写由 Lua 脚本在服务端完成。进程内的写回由脚本只改写脏字段，
+// 记录不存在或格式不符时才整条写入（见 PlayerScripts）；新玩家与缓存回填整条写入。
+class PlayerRecord
+{
+public:
+    static constexpr char kVersion = 1;
+    static constexpr size_t kBinarySize = 1 + 4 * PlayerCache::FIELD_COUNT;
+
+    // 二进制编解码，长度或版本号不符时 decode 返回 false
+    static std::string encode(const msg::PlayerAttr &attr);
+    static bool decode(const std::string &data, msg::PlayerAttr &out);
+
+    // hash 格式编解码，缺字段时 fromHash 返回 false
+    static std::unordered_map<std::string, std::string> toHash(const msg::PlayerAttr &attr);
+    static bool fromHash(const std::unordered_map<std::string, std::string> &data, msg::PlayerAttr &out);
+
+    // 字段在二进制记录中的偏移
+    static constexpr size_t fieldOffset(PlayerCache::Field field)
+    {
+        return 1 + 4 * static_cast<size_t>(field);
+    }
+};
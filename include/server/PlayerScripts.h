@@ -0,0 +1,26 @@
+#pragma once
+#include <string>
+
+// 玩家数据的服务端 Lua 脚本。启动时 SCRIPT LOAD，之后用 EVALSHA 调用，
+// 读改写在 Redis 内原子完成，多个 GameServer 进程共享同一个 Redis 时结果仍然正确。
+// 脚本同时兼容 hash 与二进制两种存储格式（见 PlayerRecord）。
+// 写入的脚本会清除 key 上的过期时间（玩家下线时设置，重新上线修改后不再过期）。
+class PlayerScripts
+{
+public:
+    enum Id
+    {
+        // 增加经验并计算升级：KEYS = {key}，ARGV = {add_exp}
+        // 返回 {level, exp, leveled_up}，玩家不存在时返回空数组
+        ADD_EXP = 0,
+        // 二进制格式写回：KEYS = {key}，ARGV = {dirty_mask, record}
+        // 只改写脏字段（SETRANGE），记录不存在或格式不符时整条写入
+        WRITE_BINARY,
+        // hash 格式写回：KEYS = {key}，ARGV = {dirty_mask, level, exp, hp, mp, coin, x, y, z}
+        // 只改写脏字段，记录不存在或格式不符时整条写入
+        WRITE_HASH,
+        SCRIPT_COUNT
+    };
+
+    static const char *source(Id id);
+};
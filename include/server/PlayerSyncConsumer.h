@@ -0,0 +1,96 @@
+#pragma once
+#include "SyncCoalescer.h"
+
+#include <cppkafka/cppkafka.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// kafka → MySQL 同步消费者：一个线程拉取消息，按分区分发给 N 个同步线程并行写 MySQL。
+// - 同一分区（即同一玩家，消息 key 为 uid）总是由同一个同步线程处理，保持顺序
+// - 每个同步线程各自做写合并（SyncCoalescer），写出成功后才提交这批消息所在分区的 offset
+// - 分区被回收（rebalance）前先让所有同步线程写完已拉取的消息并同步提交，
+//   新的消费者从已写入的位置继续，不丢消息（至少一次）
+// - 定期统计每个分区的堆积量（高水位 - 已提交 offset）
+class PlayerSyncConsumer
+{
+public:
+    struct Options
+    {
+        std::string brokers = "127.0.0.1:9092";
+        std::string group_id = "game_server_consumer";
+        std::string topic = "playerdata_update";
+        size_t workers = 4;                          // 同步线程数
+        std::chrono::milliseconds window{500};       // 写合并窗口
+        size_t max_uids = 500;                       // 单次写出的最多玩家数
+        size_t poll_batch = 500;                     // 单次拉取的最多消息数
+        size_t max_queued = 20000;                   // 单个同步线程积压的消息数上限，超过后暂停拉取
+        std::chrono::milliseconds lag_report{10000}; // 堆积量日志间隔
+    };
+    // 写出一批玩家（在同步线程上调用），返回 false 表示失败、下个窗口重试
+    using SyncFunc = std::function<bool(const std::vector<int> &uids)>;
+
+    PlayerSyncConsumer(Options options, SyncFunc sync);
+    ~PlayerSyncConsumer();
+
+    // 在调用线程上运行拉取循环，直到 stop；退出前写完已拉取的消息并提交 offset。
+    // 析构前 run 必须已经返回
+    void run();
+    // 可在任意线程调用
+    void stop();
+
+    // 分区堆积量
+    struct PartitionLag
+    {
+        int partition;
+        long long high_watermark; // 分区最新 offset
+        long long committed;      // 已写入 MySQL 并提交的 offset（下一条待消费的位置）
+        long long lag;
+    };
+    std::vector<PartitionLag> lag() const;
+
+private:
+    struct Worker
+    {
+        std::thread thread;
+        std::mutex mtx;
+        std::condition_variable cv;
+        std::deque<cppkafka::Message> queue;
+        size_t drain_requested = 0; // 请求写完全部消息的次数（rebalance）
+        size_t drain_done = 0;
+        std::unique_ptr<SyncCoalescer> coalescer;
+        std::map<int, long long> pending; // 已加入合并但未写出的各分区最大 offset
+    };
+
+    void worker_loop(Worker &worker);
+    // 同步线程写出成功后登记可提交的 offset
+    void ready_to_commit(const std::map<int, long long> &offsets);
+    // 提交已写出的 offset（拉取线程上调用）
+    void commit(bool sync);
+    // 让所有同步线程写完已拉取的消息并等待完成
+    void drain_all();
+    void report_lag();
+
+    Options options_;
+    SyncFunc sync_;
+    std::unique_ptr<cppkafka::Consumer> consumer_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<bool> stop_ = false;
+    std::atomic<bool> quit_ = false; // 通知同步线程退出
+
+    mutable std::mutex commit_mtx_;
+    std::map<int, long long> to_commit_; // 分区 -> 下一条待消费的 offset
+    std::map<int, long long> committed_; // 已提交的 offset
+    std::map<int, long long> high_;      // 最近一次查询的高水位
+    std::set<int> assigned_;             // 当前分配给本消费者的分区
+};
@@ -0,0 +1,92 @@
+#pragma once
+#include <sw/redis++/redis++.h>
+
+#include <mutex>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+// Redis 批量访问层：把多个命令合并到一个 redis++ pipeline 中，一次往返完成。
+// 并发调用方共享同一次 flush：到达时若 leader 数未满则成为 leader，负责执行排队中的所有命令，
+// 否则把命令放入队列后等待某个 leader 执行完成，不会各自占用一个连接做单独的往返。
+// 同时最多 max_leaders 个 pipeline 在途，避免占满连接池。
+class RedisBatcher
+{
+public:
+    using Hash = std::unordered_map<std::string, std::string>;
+
+    // GET 的结果；key 是 hash 等其它类型时 wrong_type 为 true
+    struct GetResult
+    {
+        std::optional<std::string> value;
+        bool wrong_type = false;
+    };
+
+    RedisBatcher(std::shared_ptr<sw::redis::Redis> redis, size_t max_batch = 256, size_t max_leaders = 4);
+
+    // 读取一个 hash，key 不存在时返回空 map
+    Hash hgetall(const std::string &key);
+    // 批量读取，结果与 keys 一一对应，只需一次往返
+    std::vector<Hash> hgetallMany(const std::vector<std::string> &keys);
+    // 写入一个 hash 的多个字段
+    void hset(const std::string &key, const Hash &fields);
+    // 批量写入，只需一次往返
+    void hsetMany(const std::vector<std::pair<std::string, Hash>> &items);
+    // 批量读取字符串，只需一次往返
+    std::vector<GetResult> getMany(const std::vector<std::string> &keys);
+    // 批量写入字符串（覆盖原有的任意类型），只需一次往返
+    void setMany(const std::vector<std::pair<std::string, std::string>> &items);
+
+    // 累计 flush 次数与命令数（用于观察合并效果）
+    size_t flushCount() const
+    {
+        return flushes_;
+    }
+    size_t commandCount() const
+    {
+        return commands_;
+    }
+
+private:
+    struct Op
+    {
+        enum Kind
+        {
+            HGETALL,
+            HSET,
+            GET,
+            SET
+        } kind;
+        const std::string *key;
+        const Hash *fields = nullptr;       // HSET 的字段
+        Hash *hash = nullptr;               // HGETALL 的结果
+        const std::string *value = nullptr; // SET 的值
+        GetResult *get = nullptr;           // GET 的结果
+    };
+    // 一个调用方提交的一组命令
+    struct Request
+    {
+        std::vector<Op> ops;
+        std::promise<void> done;
+    };
+
+    // 提交命令并等待执行完成（出错时抛出 sw::redis::Error）
+    void submit(std::vector<Op> ops);
+    // 在一个 pipeline 中执行一批请求；连接出错时整批失败，某条命令的错误回复只让它所属的请求失败
+    void flush(std::vector<Request *> &batch);
+
+    std::shared_ptr<sw::redis::Redis> redis_;
+    size_t max_batch_;   // 单次 pipeline 最多包含的命令数
+    size_t max_leaders_; // 同时在途的 pipeline 数上限
+
+    std::mutex mtx_;
+    std::vector<Request *> pending_; // 等待执行的请求
+    size_t leaders_ = 0;             // 正在执行的 leader 数
+
+    std::atomic<size_t> flushes_ = 0;
+    std::atomic<size_t> commands_ = 0;
+};
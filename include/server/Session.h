@@ -40,6 +40,16 @@ public:
     return id_;
   }
 
+  // 登录成功后记录用户id，断开连接时用于下线处理
+  void setuid(int uid)
+  {
+    uid_ = uid;
+  }
+  int getuid()
+  {
+    return uid_;
+  }
+
 private:
   boost::asio::ip::tcp::socket socket_;
 
@@ -57,7 +67,7 @@ private:
   std::deque<std::vector<char>> write_queue_; // 写队列 用于写数据
 
   int id_;  // 用于通信区分不同session
-  int uid_; // 用户id
+  std::atomic<int> uid_; // 用户id（登录前为 -1；工作线程写，io 线程读）
   // **新增静态成员：用于生成唯一 ID 的计数器**
   static std::atomic<int> next_id_;
   MessageDispatcher &dispatcher_; // 用于分发任务
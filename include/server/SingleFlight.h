@@ -0,0 +1,60 @@
+#pragma once
+#include <mutex>
+#include <future>
+#include <unordered_map>
+
+// 请求合并（single-flight）：同一个 key 同时只有一次加载在执行，
+// 期间到达的调用方不再重复加载，而是等待并共享这一次的结果（包括异常）。
+// 加载结束即移除记录，之后的调用会重新加载（结果缓存由调用方负责）。
+template <typename K, typename V>
+class SingleFlight
+{
+public:
+    template <typename F>
+    V run(const K &key, F &&load)
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        auto it = calls_.find(key);
+        if (it != calls_.end())
+        {
+            // 已有加载在执行，等待其结果
+            std::shared_future<V> result = it->second;
+            lock.unlock();
+            return result.get();
+        }
+        std::promise<V> promise;
+        calls_.emplace(key, promise.get_future().share());
+        lock.unlock();
+
+        try
+        {
+            V value = load();
+            finish(key);
+            promise.set_value(value);
+            return value;
+        }
+        catch (...)
+        {
+            finish(key);
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+    }
+
+    // 正在加载的 key 数
+    size_t inflight() const
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return calls_.size();
+    }
+
+private:
+    void finish(const K &key)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        calls_.erase(key);
+    }
+
+    mutable std::mutex mtx_;
+    std::unordered_map<K, std::shared_future<V>> calls_;
+};
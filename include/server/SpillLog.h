@@ -0,0 +1,81 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 本地落盘队列：kafka 不可用时把消息追加到本地分段文件，broker 恢复后再回放。
+// - append 只把记录拷贝进内存缓冲区就返回，由后台线程批量写盘并 fdatasync，不阻塞调用线程
+// - 文件按段滚动（seg-<序号>.log），回放按段进行：最早的段整段发送并确认后删除
+// - 记录带 CRC，进程崩溃留下的半条记录在读取时丢弃
+// - 启动时目录里已有的段视为待回放
+class SpillLog
+{
+public:
+    struct Options
+    {
+        std::string dir;
+        size_t segment_bytes = 16 << 20;               // 单段大小上限，写满后滚动到新段
+        size_t max_bytes = 1ull << 30;                 // 未回放数据的总上限，超过后 append 失败
+        std::chrono::milliseconds sync_interval{100}; // 后台写盘间隔（最多丢失这段时间内的记录）
+    };
+
+    struct Record
+    {
+        std::string key;
+        std::string payload;
+    };
+
+    explicit SpillLog(Options options);
+    // 写完缓冲区中的记录后返回
+    ~SpillLog();
+
+    // 追加一条记录，超过 max_bytes 时返回 false
+    bool append(const std::string &key, const std::string &payload);
+
+    // 读取最早的一段（没有已封存的段时先封存当前段），没有待回放的数据时返回 false
+    bool oldestSegment(uint64_t &id, std::vector<Record> &records);
+    // 回放完成后删除该段
+    void removeSegment(uint64_t id);
+
+    // 尚未回放的字节数（含缓冲区）
+    size_t pendingBytes() const
+    {
+        return pending_bytes_;
+    }
+    // 写盘失败而丢失的记录数
+    size_t lost() const
+    {
+        return lost_;
+    }
+
+private:
+    void writer_loop();
+    // 把缓冲区写入当前段（已持有 file_mtx_）
+    void write_buffer(std::string &buffer, size_t records);
+    // 关闭当前段，之后的写入进入新段（已持有 file_mtx_）
+    void seal_active();
+    std::string segment_path(uint64_t id) const;
+
+    Options options_;
+
+    std::mutex mtx_; // 保护 buffer_（与 file_mtx_ 同时持有时后取）
+    std::condition_variable cv_;
+    std::string buffer_;
+    size_t buffer_records_ = 0;
+    bool stop_ = false;
+
+    std::mutex file_mtx_; // 保护以下文件状态
+    std::vector<uint64_t> sealed_; // 已封存、待回放的段，按序号升序
+    uint64_t active_id_ = 0;
+    int active_fd_ = -1;
+    size_t active_size_ = 0;
+
+    std::atomic<size_t> pending_bytes_ = 0;
+    std::atomic<size_t> lost_ = 0;
+    std::thread writer_;
+};
@@ -0,0 +1,53 @@
+#pragma once
+#include <chrono>
+#include <functional>
+#include <unordered_set>
+#include <vector>
+
+// kafka → MySQL 的写合并（write-behind）：消费到的更新消息只记录“哪个玩家变了”，
+// 在时间窗口或数量上限到达时把窗口内的玩家按 uid 去重后一次性写出。
+// 刷经验时同一玩家每秒几十条消息，合并后每个窗口只写一次。
+// 只在消费线程上使用，不加锁。
+class SyncCoalescer
+{
+public:
+    // 写出一批玩家，返回 false 表示失败（这批玩家保留到下一个窗口重试）
+    using Flush = std::function<bool(const std::vector<int> &uids)>;
+
+    SyncCoalescer(Flush flush, std::chrono::milliseconds window, size_t max_uids);
+
+    // 记录一条更新消息
+    void add(int uid);
+    // 窗口到期或玩家数达到上限时写出，返回本次是否写出成功（没有需要写出的也算成功）
+    bool maybeFlush();
+    // 立即写出窗口内的所有玩家
+    bool flush();
+
+    size_t pending() const
+    {
+        return dirty_.size();
+    }
+
+    // 合并效果：累计消息数、写出的玩家数（MySQL 行数）与写出次数
+    struct Stats
+    {
+        size_t messages;
+        size_t written_uids;
+        size_t flushes;
+        size_t failed_flushes;
+    };
+    Stats stats() const
+    {
+        return stats_;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    Flush flush_;
+    std::chrono::milliseconds window_;
+    size_t max_uids_;
+    std::unordered_set<int> dirty_;
+    Clock::time_point window_start_; // 窗口内第一条消息的时间
+    Stats stats_{};
+};
@@ -6,71 +6,121 @@
 #include <thread>
 #include <condition_variable>
 #include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+
+#include "TimerWheel.h"
 // 定义用于分组的任务结构体
 struct AffinityTask
 {
     long long key;              // 用于分组的键（如 sessionid）
     std::function<void()> func; // 要执行的实际函数
+    int msgid = 0;              // 任务对应的消息号（看门狗诊断用，0 表示未知）
+    int vshard = -1;            // 所属虚拟分片，-1 表示通用任务
+};
+
+// 每个工作线程当前正在执行任务的状态，供看门狗线程无锁读取
+struct WorkerState
+{
+    std::atomic<long long> task_start_ns{0}; // 当前任务开始时间（steady_clock 纳秒），0 表示空闲
+    std::atomic<long long> key{0};           // 当前任务的 key
+    std::atomic<int> msgid{0};               // 当前任务的消息号
+    std::atomic<bool> stalled{false};        // 当前任务是否已被判定为卡死
+    std::atomic<long long> last_busy_ns{0};  // 最近一次执行完任务的时间，用于判断空闲缩容
+    bool running = false;                    // 线程是否在运行（受对应队列锁保护）
+    bool retiring = false;                   // 是否正在退役：队列清空后线程退出（受对应队列锁保护）
+};
+
+// 虚拟分片：key 先映射到固定数量的虚拟分片，再由虚拟分片映射到工作线程。
+// 只有当虚拟分片没有未完成任务时才允许改变归属，因此扩缩容不会打乱同一 key 的执行顺序。
+struct VirtualShard
+{
+    std::mutex mtx;                 // 保护 owner 的读改写，并保证同一分片投递的先后顺序
+    size_t owner = 0;               // 当前归属的工作线程
+    std::atomic<size_t> pending{0}; // 已投递但尚未执行完的任务数
+};
+
+// 弹性线程池配置：min_threads == max_threads 时为固定大小
+struct ElasticOptions
+{
+    size_t min_threads = 1;
+    size_t max_threads = 1;
+    size_t scale_up_queue_depth = 8;                // 平均每个线程积压超过该值视为过载
+    std::chrono::milliseconds scale_up_sustain{500}; // 过载持续该时长才扩容
+    std::chrono::milliseconds idle_timeout{30000};   // 线程空闲超过该时长才缩容
 };
 
 class ThreadPool
 {
 public:
+    // 固定大小线程池
     ThreadPool(size_t num_threads);
+    // 弹性线程池：线程数在 [min_threads, max_threads] 之间随队列积压伸缩
+    ThreadPool(const ElasticOptions &options);
     ~ThreadPool();
 
     template <typename F>
-    void enqueue_with_key(long long key, F &&f) // 把任务加入到相应的任务队列
+    void enqueue_with_key(long long key, F &&f, int msgid = 0) // 把任务加入到相应的任务队列
     {
-        // 计算位于哪个index
-        // 确保同一 Key 的任务总是被映射到同一个索引（同一个队列）
-        size_t index = std::hash<long long>{}(key) % num_threads_;
-
-        // 2. 构造任务
-        AffinityTask affinity_task = {key, std::forward<F>(f)};
-        {
-            // 获取对应队列锁
-            std::unique_lock<std::mutex> lock(*queue_mutexes_[index]);
-
-            if (stop_)
-            {
-                throw std::runtime_error("Attempted to enqueue task on a stopped ThreadPool.");
-            }
-            sharded_queues_[index].push(std::move(affinity_task));
-        }
-
-        conditions_[index]->notify_one();
+        // 确保同一 Key 的任务总是被映射到同一个虚拟分片（同一时刻只会在一个队列里）
+        push_keyed(key, std::function<void()>(std::forward<F>(f)), msgid);
     }
     template <typename F>
     void enqueue(F &&f)
     {
-        // 1. 使用轮询策略选择一个队列索引
-        // next_queue_index_++ 确保原子递增，% num_threads_ 保证在有效范围内
-        size_t index = next_queue_index_++ % num_threads_;
-
-        // 2. 构造一个 AffinityTask，Key 可以设置为 0 或其他无效值
-        AffinityTask general_task = {0, std::forward<F>(f)};
-
-        {
-            // 获取对应队列锁
-            std::unique_lock<std::mutex> lock(*queue_mutexes_[index]);
+        // 通用任务没有顺序要求，轮询投递到活跃线程
+        push_general(std::function<void()>(std::forward<F>(f)));
+    }
 
-            if (stop_)
-            {
-                throw std::runtime_error("Attempted to enqueue task on a stopped ThreadPool.");
-            }
+    // 延迟 delay 后按 key 投递任务（与 enqueue_with_key 同样保证同 key 顺序）
+    template <typename F>
+    TimerId enqueue_after(long long key, std::chrono::milliseconds delay, F &&f)
+    {
+        return timer_wheel_.add(key, delay, std::chrono::milliseconds(0), std::forward<F>(f));
+    }
+    // 每隔 period 按 key 投递一次任务，首次在 period 后执行
+    template <typename F>
+    TimerId enqueue_every(long long key, std::chrono::milliseconds period, F &&f)
+    {
+        return timer_wheel_.add(key, period, period, std::forward<F>(f));
+    }
+    // 取消定时任务；已经投递到队列中的那一次仍会执行
+    bool cancel_timer(TimerId id)
+    {
+        return timer_wheel_.cancel(id);
+    }
 
-            // 投递到选定的分片队列
-            sharded_queues_[index].push(std::move(general_task));
-        }
+    // 启动看门狗：任务执行超过 threshold 即判定卡死，打印 key/msgid、队列深度和线程栈
+    // reroute_on_stall 为 true 时，新任务会绕开卡死的分片（该分片上的 key 将失去顺序保证）
+    void start_watchdog(std::chrono::milliseconds threshold, bool reroute_on_stall = false);
 
-        // 通知等待的线程
-        conditions_[index]->notify_one();
+    // 看门狗累计发现的卡死次数
+    size_t stall_count() const
+    {
+        return stall_count_.load();
     }
 
+    // 线程池运行指标
+    struct Stats
+    {
+        size_t active_threads;    // 当前活跃线程数
+        size_t min_threads;       // 最小线程数
+        size_t max_threads;       // 最大线程数
+        size_t queued_tasks;      // 所有队列中积压的任务数
+        size_t scale_up_events;   // 累计扩容次数
+        size_t scale_down_events; // 累计缩容次数
+        size_t stall_events;      // 累计卡死次数
+        size_t pending_timers;    // 尚未触发的定时任务数
+    };
+    Stats stats() const;
+
 private:
-    // 记录线程数量
+    // 弹性配置
+    ElasticOptions options_;
+    // 线程槽位数量（= max_threads），槽位 [0, active_threads_) 为活跃线程
     size_t num_threads_;
+    std::atomic<size_t> active_threads_ = 0;
     // 储存工作线程
     std::vector<std::thread> workers_;
     // 任务队列 为了保证玩家操作的执行顺序，采用切片队列，让相同玩家的操作进入同一个队列
@@ -81,11 +131,53 @@ private:
     std::vector<std::unique_ptr<std::mutex>> queue_mutexes_; // 队列互斥锁分片
     // 关键：条件变量数组。每个队列有自己的条件变量，用于通知相应的线程。
     std::vector<std::unique_ptr<std::condition_variable>> conditions_; // 条件变量分片
-    // 工作线程队列
-    std::vector<std::thread> threads_;
+    // 虚拟分片 -> 工作线程映射
+    std::vector<std::unique_ptr<VirtualShard>> vshards_;
     // 线程池停止标志
     std::atomic<bool> stop_ = false;
     // 工作线程循环，每个线程负责一个队列
     void worker_loop(size_t queue_index);
     std::atomic<size_t> next_queue_index_ = 0; // 用于轮询分发通用任务
+
+    // 投递带 key 的任务（保证同 key 顺序）
+    void push_keyed(long long key, std::function<void()> func, int msgid);
+    // 投递通用任务
+    void push_general(std::function<void()> func);
+
+    // ============== 弹性伸缩 ==============
+    std::mutex scale_mutex_; // 串行化扩缩容
+    std::atomic<size_t> scale_up_events_ = 0;
+    std::atomic<size_t> scale_down_events_ = 0;
+    long long overload_since_ns_ = 0; // 过载开始时间，0 表示当前未过载（仅监控线程访问）
+    long long last_scale_ns_ = 0;     // 上次伸缩时间（仅监控线程访问）
+    // 启动槽位 index 上的工作线程（调用方持有 scale_mutex_）
+    void start_worker(size_t index);
+    // 根据队列积压与空闲时间决定是否伸缩
+    void check_scaling(long long now_ns);
+    void scale_up(size_t queued);
+    void scale_down();
+    // 队列积压总数
+    size_t queued_tasks() const;
+
+    // ============== 定时任务 ==============
+    // 所有分片共享的时间轮，由定时线程推进，到期任务按 key 投递
+    TimerWheel timer_wheel_;
+    std::thread timer_thread_;
+    void timer_loop();
+
+    // ============== 监控线程（看门狗 + 弹性伸缩） ==============
+    // 每个工作线程一份运行状态
+    std::vector<std::unique_ptr<WorkerState>> worker_states_;
+    std::thread monitor_thread_;
+    std::mutex monitor_mutex_;
+    std::condition_variable monitor_cond_;
+    std::atomic<long long> stall_threshold_ms_ = 0; // 0 表示看门狗未启用
+    std::atomic<bool> reroute_on_stall_ = false;
+    std::atomic<size_t> stall_count_ = 0;
+    // 监控线程循环
+    void monitor_loop();
+    // 检查某个工作线程是否卡死，卡死则输出诊断信息
+    void check_worker(size_t queue_index, long long now_ns);
+    // 从 index 开始在活跃线程中找到第一个没有卡死的分片；全部卡死时原样返回
+    size_t route_around_stall(size_t index) const;
 };
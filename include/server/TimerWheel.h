@@ -0,0 +1,84 @@
+#pragma once
+#include <mutex>
+#include <functional>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <cstdint>
+
+// 定时器句柄：高 32 位为代数，低 32 位为节点下标，0 表示无效
+using TimerId = uint64_t;
+
+// 分层时间轮：4 层 x 256 槽，每格 tick_ 毫秒，覆盖 2^32 个 tick。
+// 定时器节点放在数组中复用，槽内为侵入式双向链表，插入与取消都是 O(1)。
+// 所有分片共享一个时间轮，内部加锁，可以在任意线程调用。
+class TimerWheel
+{
+public:
+    using Callback = std::function<void()>;
+
+    // 到期的定时器：交给线程池按 key 投递
+    struct Expired
+    {
+        long long key;
+        std::shared_ptr<Callback> func;
+    };
+
+    explicit TimerWheel(std::chrono::milliseconds tick = std::chrono::milliseconds(10));
+
+    // 添加定时器：delay 后到期；period > 0 时为周期定时器，到期后自动按 period 重新挂入
+    TimerId add(long long key, std::chrono::milliseconds delay, std::chrono::milliseconds period, Callback func);
+    // 取消定时器，定时器不存在或已触发（一次性）时返回 false
+    bool cancel(TimerId id);
+    // 推进到当前时间，取出所有到期的定时器
+    std::vector<Expired> advance();
+
+    // 尚未触发的定时器数量
+    size_t size() const;
+    std::chrono::milliseconds tick() const
+    {
+        return tick_;
+    }
+
+private:
+    static constexpr uint32_t kNil = 0xffffffff;
+    static constexpr int kLevels = 4;
+    static constexpr int kSlotBits = 8;
+    static constexpr uint32_t kSlots = 1u << kSlotBits;
+
+    struct Node
+    {
+        uint32_t prev = kNil;
+        uint32_t next = kNil;
+        uint32_t generation = 1; // 节点每次回收代数加一，旧句柄随之失效
+        bool linked = false;     // 是否挂在某个槽上
+        uint16_t slot = 0;       // 所在槽（level * kSlots + index），用于 O(1) 摘除
+        uint64_t expire_tick = 0;
+        uint64_t period_ticks = 0; // 0 表示一次性定时器
+        long long key = 0;
+        std::shared_ptr<Callback> func;
+    };
+
+    // 当前时间对应的 tick
+    uint64_t now_tick() const;
+    // 把节点挂到与到期时间相符的槽上
+    void place(uint32_t index);
+    void link(uint32_t index, uint16_t slot);
+    void unlink(uint32_t index);
+    // 回收节点
+    void release(uint32_t index);
+    // 把高层某个槽的定时器重新分配到低层
+    void cascade(int level, uint32_t slot_index);
+    // 处理一个 tick：级联并收集第 0 层到期的定时器
+    void process_tick(std::vector<Expired> &expired);
+
+    mutable std::mutex mtx_;
+    std::chrono::milliseconds tick_;
+    std::chrono::steady_clock::time_point start_;
+    uint64_t current_tick_ = 0; // 下一个待处理的 tick
+    size_t size_ = 0;
+
+    std::vector<Node> nodes_;
+    std::vector<uint32_t> free_nodes_;
+    std::vector<uint32_t> slots_; // kLevels * kSlots 个链表头
+};
@@ -0,0 +1,72 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// 已知 uid 过滤器：客户端传来的不存在的 uid 在这里直接拦截，不再访问 Redis 和 MySQL。
+// - Bloom 过滤器记录所有已注册的 uid（启动时从 MySQL 构建，注册/建号时追加）：
+//   判定不存在则一定不存在，判定存在有少量误判
+// - 负缓存记录最近确认不存在的 uid（短 TTL），挡住误判和已注册但还没有玩家数据的 uid 的重复查询
+// 构建完成前不拦截任何 uid。只增不删（没有删号业务）。
+class UidFilter
+{
+public:
+    UidFilter(size_t expected_uids, double false_positive_rate, std::chrono::milliseconds negative_ttl);
+
+    // 记录存在的 uid，同时清除它的负缓存
+    void add(int uid);
+    // false 表示一定不存在，调用方不需要做任何 I/O
+    bool mayExist(int uid);
+    // 记录确认不存在的 uid（Redis 与 MySQL 都没有）
+    void markMissing(int uid);
+
+    // 全部 uid 已加入，开始拦截
+    void setReady();
+    bool ready() const
+    {
+        return ready_;
+    }
+    // 已加入的 uid 数（含重复加入），超过预期容量时误判率上升
+    size_t added() const
+    {
+        return added_;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+    struct Shard
+    {
+        std::mutex mtx;
+        std::unordered_map<int, Clock::time_point> expires;
+    };
+    static constexpr size_t kShards = 16;
+    // 每个分片最多记录的负缓存条目，超出时先清理过期条目，仍然满则整片清空
+    static constexpr size_t kMaxNegativePerShard = 4096;
+
+    // 第 i 个哈希位置（双重哈希）
+    size_t bit_of(uint64_t hash, int i) const
+    {
+        uint64_t h1 = hash & 0xffffffffu;
+        uint64_t h2 = (hash >> 32) | 1;
+        return (h1 + i * h2) % bit_count_;
+    }
+    static uint64_t hash_of(int uid);
+    Shard &shard_of(int uid)
+    {
+        return shards_[static_cast<unsigned>(uid) % kShards];
+    }
+
+    size_t bit_count_;
+    int hashes_;
+    std::unique_ptr<std::atomic<uint64_t>[]> bits_;
+    std::atomic<bool> ready_ = false;
+    std::atomic<size_t> added_ = 0;
+    size_t expected_;
+
+    std::chrono::milliseconds negative_ttl_;
+    std::vector<Shard> shards_;
+};
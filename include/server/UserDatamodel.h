@@ -1,16 +1,24 @@
 #pragma once
 #include "DB.h"
 #include"protocol.pb.h"
+#include <vector>
 class UserDatamodel
 {
 
 public:
     static UserDatamodel& instance();
-    bool QueryUserData(msg::PlayerAttr &playerdata);
-
-    bool UpdateUserData(msg::PlayerAttr &playerdata);
+    // 查询失败返回 false；not_found 非空时，查询成功但没有该玩家会置为 true（用于区分连接/查询错误）
+    bool QueryUserData(msg::PlayerAttr &playerdata, bool *not_found = nullptr);
+    // 批量查询：一个连接、一条 where uid in (...) 语句（超过 256 个时分块），不存在的玩家不在结果中
+    bool QueryUserDataBatch(const std::vector<int> &uids, std::vector<msg::PlayerAttr> &out);
 
     bool InsertUserData(msg::PlayerAttr &playerdata);
+
+    // 多行 INSERT ... ON DUPLICATE KEY UPDATE 写入一批玩家，分成多条语句时在一个事务里提交
+    bool UpsertUserDataBatch(const std::vector<msg::PlayerAttr> &players);
+
+    // 按 uid 顺序分页读取 uid > after_uid 的最多 limit 个玩家（缓存重建时扫描全表）
+    bool LoadUserDataRange(int after_uid, int limit, std::vector<msg::PlayerAttr> &out);
 private:
     UserDatamodel();
 };
\ No newline at end of file
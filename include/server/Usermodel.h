@@ -1,6 +1,7 @@
 #pragma once
 #include "string"
 #include <iostream>
+#include <vector>
 
 #include "GameUser.h"
 #include "DB.h"
@@ -17,6 +18,9 @@ public:
     // 登录业务，向表中查询id与name是否对应
     bool Login(GameUser &user);
 
+    // 按 uid 顺序分段读取已注册的 uid（uid > after_uid，最多 limit 个），失败返回 false
+    bool loadUids(int after_uid, int limit, std::vector<int> &out);
+
 
 private:
     Usermodel()
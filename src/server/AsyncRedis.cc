@@ -0,0 +1,378 @@
+#include "AsyncRedis.h"
+
+#include <hiredis/hiredis.h>
+#include <hiredis/async.h>
+
+#include <algorithm>
+#include <deque>
+#include <iostream>
+
+namespace
+{
+    const std::chrono::seconds kReconnectDelay(1);
+
+    AsyncRedis::Reply convert(const redisReply *reply)
+    {
+        AsyncRedis::Reply out;
+        switch (reply->type)
+        {
+        case REDIS_REPLY_STRING:
+        case REDIS_REPLY_VERB:
+            out.type = AsyncRedis::Reply::STRING;
+            out.str.assign(reply->str, reply->len);
+            break;
+        case REDIS_REPLY_STATUS:
+            out.type = AsyncRedis::Reply::STATUS;
+            out.str.assign(reply->str, reply->len);
+            break;
+        case REDIS_REPLY_ERROR:
+            out.type = AsyncRedis::Reply::ERROR;
+            out.str.assign(reply->str, reply->len);
+            break;
+        case REDIS_REPLY_INTEGER:
+        case REDIS_REPLY_BOOL:
+            out.type = AsyncRedis::Reply::INTEGER;
+            out.integer = reply->integer;
+            break;
+        case REDIS_REPLY_ARRAY:
+        case REDIS_REPLY_MAP:
+        case REDIS_REPLY_SET:
+            out.type = AsyncRedis::Reply::ARRAY;
+            out.elements.reserve(reply->elements);
+            for (size_t i = 0; i < reply->elements; ++i)
+            {
+                out.elements.push_back(convert(reply->element[i]));
+            }
+            break;
+        default:
+            out.type = AsyncRedis::Reply::NIL;
+            break;
+        }
+        return out;
+    }
+}
+
+// 单个异步连接：hiredis 上下文只在该连接的 strand 上访问，
+// 读写事件由 stream_descriptor::async_wait 驱动（hiredis 事件适配器）
+class AsyncRedis::Connection
+{
+public:
+    Connection(AsyncRedis &owner, boost::asio::io_context &io)
+        : owner_(owner), io_(io), strand_(boost::asio::make_strand(io)), reconnect_timer_(io), timeout_timer_(io)
+    {
+    }
+
+    ~Connection()
+    {
+        // io_context 已停止，直接释放；在途命令会以 DISCONNECTED 回调
+        if (ctx_)
+            redisAsyncFree(ctx_);
+    }
+
+    void start()
+    {
+        boost::asio::post(strand_, [this]
+                          { connect(); });
+    }
+
+    void command(std::vector<std::string> argv, Callback callback)
+    {
+        boost::asio::post(strand_, [this, argv = std::move(argv), callback = std::move(callback)]() mutable
+                          { send(std::move(argv), std::move(callback)); });
+    }
+
+private:
+    // 在途命令的回调与所属连接
+    struct Pending
+    {
+        Connection *conn;
+        Callback callback;
+        std::chrono::steady_clock::time_point deadline;
+        bool timed_out = false; // 已按超时回调，之后到达的回复丢弃
+    };
+
+    void connect()
+    {
+        redisAsyncContext *ctx = redisAsyncConnect(owner_.host_.c_str(), owner_.port_);
+        if (!ctx || ctx->err)
+        {
+            std::cerr << "[AsyncRedis] 连接失败：" << (ctx ? ctx->errstr : "out of memory") << std::endl;
+            if (ctx)
+                redisAsyncFree(ctx);
+            schedule_reconnect();
+            return;
+        }
+        ctx_ = ctx;
+        ctx_->data = this;
+        descriptor_ = std::make_unique<boost::asio::posix::stream_descriptor>(io_, ctx_->c.fd);
+
+        // hiredis 事件适配器
+        ctx_->ev.data = this;
+        ctx_->ev.addRead = [](void *data)
+        {
+            static_cast<Connection *>(data)->want_read(true);
+        };
+        ctx_->ev.delRead = [](void *data)
+        {
+            static_cast<Connection *>(data)->want_read(false);
+        };
+        ctx_->ev.addWrite = [](void *data)
+        {
+            static_cast<Connection *>(data)->want_write(true);
+        };
+        ctx_->ev.delWrite = [](void *data)
+        {
+            static_cast<Connection *>(data)->want_write(false);
+        };
+        ctx_->ev.cleanup = [](void *data)
+        {
+            static_cast<Connection *>(data)->cleanup();
+        };
+
+        redisAsyncSetConnectCallback(ctx_, [](const redisAsyncContext *ctx, int status)
+                                     {
+            if (status != REDIS_OK)
+            {
+                // 连接失败时 hiredis 会释放上下文且不触发断开回调
+                std::cerr << "[AsyncRedis] 连接失败：" << ctx->errstr << std::endl;
+                static_cast<Connection *>(ctx->data)->schedule_reconnect();
+            } });
+        redisAsyncSetDisconnectCallback(ctx_, [](const redisAsyncContext *ctx, int status)
+                                        {
+            auto *conn = static_cast<Connection *>(ctx->data);
+            if (status != REDIS_OK)
+                std::cerr << "[AsyncRedis] 连接断开：" << ctx->errstr << std::endl;
+            conn->schedule_reconnect(); });
+    }
+
+    void schedule_reconnect()
+    {
+        reconnect_timer_.expires_after(kReconnectDelay);
+        reconnect_timer_.async_wait(boost::asio::bind_executor(strand_, [this](const boost::system::error_code &ec)
+                                                               {
+            if (!ec && !ctx_)
+                connect(); }));
+    }
+
+    void send(std::vector<std::string> argv, Callback callback)
+    {
+        if (!ctx_)
+        {
+            Reply reply;
+            reply.type = Reply::DISCONNECTED;
+            callback(std::move(reply));
+            return;
+        }
+        std::vector<const char *> args;
+        std::vector<size_t> lens;
+        args.reserve(argv.size());
+        lens.reserve(argv.size());
+        for (const std::string &arg : argv)
+        {
+            args.push_back(arg.data());
+            lens.push_back(arg.size());
+        }
+        auto *pending = new Pending{this, std::move(callback), std::chrono::steady_clock::now() + owner_.timeout_};
+        owner_.inflight_++;
+        // hiredis 会拷贝参数到发送缓冲区，argv 在返回后即可释放
+        if (redisAsyncCommandArgv(ctx_, &Connection::on_reply, pending, static_cast<int>(args.size()), args.data(), lens.data()) != REDIS_OK)
+        {
+            owner_.inflight_--;
+            Reply reply;
+            reply.type = Reply::DISCONNECTED;
+            pending->callback(std::move(reply));
+            delete pending;
+            return;
+        }
+        inflight_.push_back(pending);
+        arm_timeout();
+    }
+
+    static void on_reply(redisAsyncContext *, void *reply, void *privdata)
+    {
+        std::unique_ptr<Pending> pending(static_cast<Pending *>(privdata));
+        Connection *conn = pending->conn;
+        conn->owner_.inflight_--;
+        // 回复按发送顺序到达，通常就是队首
+        auto it = std::find(conn->inflight_.begin(), conn->inflight_.end(), pending.get());
+        if (it != conn->inflight_.end())
+            conn->inflight_.erase(it);
+        if (pending->timed_out)
+            return;
+        Reply out;
+        if (reply)
+            out = convert(static_cast<redisReply *>(reply));
+        else
+            out.type = Reply::DISCONNECTED; // 连接释放时 hiredis 以空回复通知在途命令
+        invoke(*pending, std::move(out));
+    }
+
+    static void invoke(Pending &pending, Reply reply)
+    {
+        try
+        {
+            pending.callback(std::move(reply));
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "[AsyncRedis] 回调异常：" << e.what() << std::endl;
+        }
+    }
+
+    // 在最早的在途命令到期时检查超时
+    void arm_timeout()
+    {
+        if (timeout_armed_ || inflight_.empty() || owner_.timeout_.count() <= 0)
+            return;
+        timeout_armed_ = true;
+        timeout_timer_.expires_at(inflight_.front()->deadline);
+        timeout_timer_.async_wait(boost::asio::bind_executor(strand_, [this](const boost::system::error_code &ec)
+                                                             {
+            timeout_armed_ = false;
+            if (!ec)
+                check_timeout(); }));
+    }
+
+    void check_timeout()
+    {
+        if (inflight_.empty())
+            return;
+        if (inflight_.front()->deadline > std::chrono::steady_clock::now())
+        {
+            arm_timeout();
+            return;
+        }
+        // 最早的命令超时：排在它后面的回复也到不了，全部以 TIMEOUT 结束，断开后重连
+        std::cerr << "[AsyncRedis] 命令超时，断开重连，在途 " << inflight_.size() << " 条" << std::endl;
+        std::deque<Pending *> expired = inflight_;
+        for (Pending *pending : expired)
+        {
+            if (pending->timed_out)
+                continue;
+            pending->timed_out = true;
+            Reply reply;
+            reply.type = Reply::TIMEOUT;
+            invoke(*pending, std::move(reply));
+        }
+        // 释放上下文：hiredis 以空回复结束在途命令（已经回调过，直接丢弃）
+        if (ctx_)
+        {
+            redisAsyncFree(ctx_);
+            schedule_reconnect();
+        }
+    }
+
+    void want_read(bool on)
+    {
+        reading_ = on;
+        if (on)
+            arm_read();
+    }
+
+    void want_write(bool on)
+    {
+        writing_ = on;
+        if (on)
+            arm_write();
+    }
+
+    void arm_read()
+    {
+        if (read_armed_ || !descriptor_)
+            return;
+        read_armed_ = true;
+        descriptor_->async_wait(boost::asio::posix::stream_descriptor::wait_read,
+                                boost::asio::bind_executor(strand_, [this, generation = generation_](const boost::system::error_code &ec)
+                                                           {
+            if (generation != generation_)
+                return; // 旧连接的事件
+            read_armed_ = false;
+            if (ec || !reading_)
+                return;
+            redisAsyncHandleRead(ctx_);
+            // 处理回复时连接可能已经被释放
+            if (generation == generation_ && reading_)
+                arm_read(); }));
+    }
+
+    void arm_write()
+    {
+        if (write_armed_ || !descriptor_)
+            return;
+        write_armed_ = true;
+        descriptor_->async_wait(boost::asio::posix::stream_descriptor::wait_write,
+                                boost::asio::bind_executor(strand_, [this, generation = generation_](const boost::system::error_code &ec)
+                                                           {
+            if (generation != generation_)
+                return; // 旧连接的事件
+            write_armed_ = false;
+            if (ec || !writing_)
+                return;
+            redisAsyncHandleWrite(ctx_);
+            if (generation == generation_ && writing_)
+                arm_write(); }));
+    }
+
+    // hiredis 释放上下文时调用：fd 由 hiredis 关闭，这里只解除关联
+    void cleanup()
+    {
+        generation_++;
+        reading_ = writing_ = false;
+        read_armed_ = write_armed_ = false;
+        if (descriptor_)
+        {
+            descriptor_->release();
+            descriptor_.reset();
+        }
+        ctx_ = nullptr;
+    }
+
+    AsyncRedis &owner_;
+    boost::asio::io_context &io_;
+    boost::asio::strand<boost::asio::io_context::executor_type> strand_;
+    boost::asio::steady_timer reconnect_timer_;
+    boost::asio::steady_timer timeout_timer_;
+    redisAsyncContext *ctx_ = nullptr;
+    std::deque<Pending *> inflight_; // 已发送未回复的命令，按发送顺序
+    bool timeout_armed_ = false;
+    std::unique_ptr<boost::asio::posix::stream_descriptor> descriptor_;
+    size_t generation_ = 0; // 每次释放上下文加一，丢弃旧连接上残留的事件
+    bool reading_ = false;
+    bool writing_ = false;
+    bool read_armed_ = false;
+    bool write_armed_ = false;
+};
+
+AsyncRedis::AsyncRedis(boost::asio::io_context &io, std::string host, int port, size_t connections,
+                       std::chrono::milliseconds timeout)
+    : io_(io), host_(std::move(host)), port_(port), timeout_(timeout)
+{
+    for (size_t i = 0; i < std::max<size_t>(1, connections); ++i)
+    {
+        connections_.push_back(std::make_unique<Connection>(*this, io_));
+    }
+}
+
+AsyncRedis::~AsyncRedis() = default;
+
+void AsyncRedis::start()
+{
+    for (auto &conn : connections_)
+    {
+        conn->start();
+    }
+}
+
+void AsyncRedis::command(size_t shard, std::vector<std::string> argv, Callback callback)
+{
+    connections_[shard % connections_.size()]->command(std::move(argv), std::move(callback));
+}
+
+std::future<AsyncRedis::Reply> AsyncRedis::command(size_t shard, std::vector<std::string> argv)
+{
+    auto promise = std::make_shared<std::promise<Reply>>();
+    std::future<Reply> result = promise->get_future();
+    command(shard, std::move(argv), [promise](Reply reply)
+            { promise->set_value(std::move(reply)); });
+    return result;
+}
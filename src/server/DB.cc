@@ -1,34 +1,256 @@
 #include "DB.h"
+#include <mysql/errmsg.h>
+#include <cstring>
 #include <iostream>
-// 初始化数据库连接
-MySQL::MySQL()
+#include <vector>
+
+MySQLConnection::~MySQLConnection()
+{
+    for (const auto &[sql, stmt] : statements)
+    {
+        mysql_stmt_close(stmt);
+    }
+    if (conn)
+        mysql_close(conn);
+}
+
+MySQLPool &MySQLPool::instance()
 {
-    _conn = mysql_init(nullptr);
+    static MySQLPool pool;
+    return pool;
 }
 
-// 释放数据库连接资源
-MySQL::~MySQL()
+MySQLPool::MySQLPool()
 {
-    if (_conn != nullptr)
+    // mysql_init 第一次调用时会初始化客户端库，多线程下需要提前显式初始化
+    mysql_library_init(0, nullptr, nullptr);
+}
+
+MySQLPool::~MySQLPool()
+{
+    for (const Idle &idle : _idle)
     {
-        mysql_close(_conn);
+        delete idle.conn;
     }
 }
 
-// 连接数据库
-bool MySQL::connect()
+void MySQLPool::configure(const Options &options)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _options = options;
+    }
+    // 预先建立连接，启动后的第一批请求不用等握手
+    std::vector<MySQLConnection *> warm;
+    for (size_t i = 0; i < options.min_size; ++i)
+    {
+        if (MySQLConnection *conn = acquire())
+            warm.push_back(conn);
+    }
+    for (MySQLConnection *conn : warm)
+    {
+        release(conn, false);
+    }
+    std::cout << "[MySQLPool] 预建立 " << warm.size() << " 个连接，最多 " << options.max_size << " 个" << std::endl;
+}
+
+MySQLConnection *MySQLPool::open()
 {
-    MYSQL *p = mysql_real_connect(_conn, server.c_str(), user.c_str(), password.c_str(), dbname.c_str(), 3306, nullptr, 0);
-    if (p != nullptr)
+    auto conn = std::make_unique<MySQLConnection>();
+    conn->conn = mysql_init(nullptr);
+    if (conn->conn == nullptr)
+        return nullptr;
+    if (mysql_real_connect(conn->conn, server.c_str(), user.c_str(), password.c_str(), dbname.c_str(), 3306, nullptr, 0) == nullptr)
     {
-        mysql_query(_conn, "set names gbk");
-        std::cout << "connect mysql success!" << std::endl;
+        std::cout << "connect mysql fail! " << mysql_error(conn->conn) << std::endl;
+        return nullptr;
     }
-    else
+    mysql_query(conn->conn, "set names gbk");
+    return conn.release();
+}
+
+MySQLConnection *MySQLPool::acquire()
+{
+    using Clock = std::chrono::steady_clock;
+    std::unique_lock<std::mutex> lock(_mtx);
+    const Clock::time_point deadline = Clock::now() + _options.checkout_timeout;
+    bool waited = false;
+    while (true)
+    {
+        // 超过 min_size 的连接空闲太久时关闭（最早归还的在头部）
+        Clock::time_point now = Clock::now();
+        while (_total > _options.min_size && !_idle.empty() && now - _idle.front().since > _options.max_idle)
+        {
+            delete _idle.front().conn;
+            _idle.pop_front();
+            _total--;
+        }
+
+        if (!_idle.empty())
+        {
+            // 取最近归还的连接，最不容易被服务端超时断开
+            Idle idle = _idle.back();
+            _idle.pop_back();
+            if (now - idle.since < _options.ping_idle)
+                return idle.conn;
+            // 空闲较久，先检查连接是否还可用
+            lock.unlock();
+            if (mysql_ping(idle.conn->conn) == 0)
+                return idle.conn;
+            delete idle.conn;
+            MySQLConnection *conn = open();
+            lock.lock();
+            _stats.reconnects++;
+            if (conn)
+            {
+                _stats.created++;
+                return conn;
+            }
+            _total--;
+            _cv.notify_one();
+            return nullptr;
+        }
+
+        if (_total < _options.max_size)
+        {
+            // 占住名额后在锁外建立连接
+            _total++;
+            lock.unlock();
+            MySQLConnection *conn = open();
+            lock.lock();
+            if (conn)
+            {
+                _stats.created++;
+                return conn;
+            }
+            _total--;
+            _cv.notify_one();
+            return nullptr;
+        }
+
+        // 连接都已借出，等待归还
+        if (!waited)
+        {
+            waited = true;
+            _stats.waits++;
+        }
+        if (_cv.wait_until(lock, deadline) == std::cv_status::timeout && _idle.empty() && _total >= _options.max_size)
+        {
+            _stats.timeouts++;
+            std::cerr << "[MySQLPool] 等待连接超时（" << _options.checkout_timeout.count() << "ms）" << std::endl;
+            return nullptr;
+        }
+    }
+}
+
+void MySQLPool::release(MySQLConnection *conn, bool broken)
+{
+    if (conn == nullptr)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        if (broken)
+        {
+            _total--;
+        }
+        else
+        {
+            _idle.push_back({conn, std::chrono::steady_clock::now()});
+            conn = nullptr;
+        }
+    }
+    delete conn;
+    _cv.notify_one();
+}
+
+MySQLPool::Stats MySQLPool::stats()
+{
+    std::lock_guard<std::mutex> lock(_mtx);
+    Stats s = _stats;
+    s.total = _total;
+    s.idle = _idle.size();
+    return s;
+}
+
+MySQLBinds::MySQLBinds(size_t count)
+    : _binds(count), _lengths(count), _nulls(new NullFlag[count]())
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        _binds[i].length = &_lengths[i];
+        _binds[i].is_null = &_nulls[i];
+    }
+}
+
+void MySQLBinds::setInt(size_t i, int *value)
+{
+    _binds[i].buffer_type = MYSQL_TYPE_LONG;
+    _binds[i].buffer = value;
+    _binds[i].buffer_length = sizeof(int);
+}
+
+void MySQLBinds::setFloat(size_t i, float *value)
+{
+    _binds[i].buffer_type = MYSQL_TYPE_FLOAT;
+    _binds[i].buffer = value;
+    _binds[i].buffer_length = sizeof(float);
+}
+
+void MySQLBinds::setString(size_t i, const std::string &value)
+{
+    _binds[i].buffer_type = MYSQL_TYPE_STRING;
+    _binds[i].buffer = const_cast<char *>(value.data());
+    _binds[i].buffer_length = value.size();
+    _lengths[i] = value.size();
+}
+
+void MySQLBinds::setBuffer(size_t i, char *buffer, size_t capacity)
+{
+    _binds[i].buffer_type = MYSQL_TYPE_STRING;
+    _binds[i].buffer = buffer;
+    _binds[i].buffer_length = capacity;
+}
+
+unsigned long MySQLBinds::length(size_t i) const
+{
+    return _lengths[i];
+}
+
+bool MySQLBinds::isNull(size_t i) const
+{
+    return _nulls[i];
+}
+
+MYSQL_BIND *MySQLBinds::data()
+{
+    return _binds.data();
+}
+
+// 初始化数据库连接
+MySQL::MySQL() : _pooled(nullptr), _conn(nullptr)
+{
+}
+
+// 释放数据库连接资源：归还给连接池
+MySQL::~MySQL()
+{
+    if (_transaction)
+        rollback();
+    MySQLPool::instance().release(_pooled, _broken);
+}
+
+// 连接数据库：从连接池取一个连接
+bool MySQL::connect()
+{
+    if (_pooled == nullptr)
+        _pooled = MySQLPool::instance().acquire();
+    if (_pooled == nullptr)
     {
         std::cout << "connect mysql fail!" << std::endl;
+        return false;
     }
-    return p;
+    _conn = _pooled->conn;
+    return true;
 }
 // 更新操作
 bool MySQL::update(std::string sql)
@@ -37,6 +259,7 @@ bool MySQL::update(std::string sql)
     {
         std::cout << __FILE__ << ":" << __LINE__ << ": "
                   << sql << " 更新失败! 错误信息：" << mysql_error(_conn) << std::endl;
+        checkBroken(mysql_errno(_conn));
         return false;
     }
     return true;
@@ -49,6 +272,7 @@ MYSQL_RES *MySQL::query(std::string sql)
     {
         std::cout << __FILE__ << ":" << __LINE__ << ":"
                   << sql << "查询失败！" << std::endl;
+        checkBroken(mysql_errno(_conn));
         return nullptr;
     }
     return mysql_use_result(_conn);
@@ -57,4 +281,100 @@ MYSQL_RES *MySQL::query(std::string sql)
 MYSQL *MySQL::getConnection()
 {
     return _conn;
-}
\ No newline at end of file
+}
+
+MYSQL_STMT *MySQL::prepare(const std::string &sql)
+{
+    auto it = _pooled->statements.find(sql);
+    if (it != _pooled->statements.end())
+        return it->second;
+    MYSQL_STMT *stmt = mysql_stmt_init(_conn);
+    if (stmt == nullptr)
+        return nullptr;
+    if (mysql_stmt_prepare(stmt, sql.c_str(), sql.size()))
+    {
+        std::cout << __FILE__ << ":" << __LINE__ << ": "
+                  << sql << " 预处理失败! 错误信息：" << mysql_stmt_error(stmt) << std::endl;
+        checkBroken(mysql_stmt_errno(stmt));
+        mysql_stmt_close(stmt);
+        return nullptr;
+    }
+    _pooled->statements.emplace(sql, stmt);
+    return stmt;
+}
+
+bool MySQL::execute(MYSQL_STMT *stmt, MySQLBinds *params, MySQLBinds *results)
+{
+    // 上一次执行留下的结果集
+    mysql_stmt_free_result(stmt);
+    bool ok = !(params && mysql_stmt_bind_param(stmt, params->data())) &&
+              !mysql_stmt_execute(stmt) &&
+              !(results && (mysql_stmt_bind_result(stmt, results->data()) || mysql_stmt_store_result(stmt)));
+    if (ok)
+        return true;
+    std::cout << __FILE__ << ":" << __LINE__ << ": 执行预处理语句失败! 错误信息：" << mysql_stmt_error(stmt) << std::endl;
+    checkBroken(mysql_stmt_errno(stmt));
+    // 语句可能已失效（例如表结构变更），从缓存中移除，下次重新准备
+    for (auto it = _pooled->statements.begin(); it != _pooled->statements.end(); ++it)
+    {
+        if (it->second == stmt)
+        {
+            _pooled->statements.erase(it);
+            mysql_stmt_close(stmt);
+            break;
+        }
+    }
+    return false;
+}
+
+bool MySQL::fetch(MYSQL_STMT *stmt)
+{
+    int rc = mysql_stmt_fetch(stmt);
+    if (rc == MYSQL_DATA_TRUNCATED)
+        std::cout << __FILE__ << ":" << __LINE__ << ": 结果被截断" << std::endl;
+    return rc == 0 || rc == MYSQL_DATA_TRUNCATED;
+}
+
+bool MySQL::begin()
+{
+    if (mysql_autocommit(_conn, false) != 0)
+    {
+        checkBroken(mysql_errno(_conn));
+        return false;
+    }
+    _transaction = true;
+    return true;
+}
+
+bool MySQL::commit()
+{
+    _transaction = false;
+    if (mysql_commit(_conn) != 0)
+    {
+        std::cout << __FILE__ << ":" << __LINE__ << ": "
+                  << "提交失败! 错误信息：" << mysql_error(_conn) << std::endl;
+        checkBroken(mysql_errno(_conn));
+        // 提交失败时服务端已回滚，恢复自动提交后连接仍可复用
+        if (!_broken && mysql_autocommit(_conn, true) != 0)
+            checkBroken(mysql_errno(_conn));
+        return false;
+    }
+    if (mysql_autocommit(_conn, true) != 0)
+        checkBroken(mysql_errno(_conn));
+    return true;
+}
+
+void MySQL::rollback()
+{
+    _transaction = false;
+    if (_broken)
+        return; // 连接已断开，服务端会丢弃未提交的事务
+    if (mysql_rollback(_conn) != 0 || mysql_autocommit(_conn, true) != 0)
+        checkBroken(mysql_errno(_conn));
+}
+
+void MySQL::checkBroken(unsigned int err)
+{
+    if (err == CR_SERVER_GONE_ERROR || err == CR_SERVER_LOST || err == CR_COMMANDS_OUT_OF_SYNC)
+        _broken = true;
+}
@@ -0,0 +1,237 @@
+#include "KafkaPublisher.h"
+
+#include <cstdint>
+#include <iostream>
+
+namespace
+{
+    // 队列满时的等待：每次 poll 一小段时间，已确认的消息处理完投递回调后才会出队
+    const int kQueueFullRetries = 10;
+    const std::chrono::milliseconds kQueueFullWait(10);
+    // 探测 broker 是否恢复的超时
+    const std::chrono::milliseconds kProbeTimeout(1000);
+}
+
+KafkaPublisher::KafkaPublisher(Options options) : options_(std::move(options))
+{
+    cppkafka::Configuration config = {
+        {"queue.buffering.max.ms", options_.linger_ms},
+        {"batch.num.messages", options_.batch_messages},
+        {"queue.buffering.max.messages", options_.queue_max_messages},
+        {"message.timeout.ms", options_.message_timeout_ms},
+        // 幂等生产者：librdkafka 在 message.timeout.ms 内自行重试，同一分区内不乱序、不重复。
+        // 应用层不再重投（重投的消息会排到同一玩家更新的事件之后）
+        {"enable.idempotence", true}};
+    if (!options_.brokers.empty())
+        config.set("metadata.broker.list", options_.brokers);
+    for (const auto &[name, value] : options_.extra_config)
+    {
+        config.set(name, value);
+    }
+    config.set_delivery_report_callback([this](cppkafka::Producer &, const cppkafka::Message &message)
+                                        { on_delivery(message); });
+    // 所有 broker 都连不上时直接落盘，不再往发送队列里堆消息
+    config.set_error_callback([this](cppkafka::KafkaHandleBase &, int error, const std::string &reason)
+                              {
+        if (error == RD_KAFKA_RESP_ERR__ALL_BROKERS_DOWN && !broker_down_.exchange(true))
+            std::cerr << "[KafkaError] broker 不可用：" << reason << std::endl; });
+    if (!options_.spill_dir.empty())
+    {
+        SpillLog::Options spill_opts;
+        spill_opts.dir = options_.spill_dir;
+        spill_ = std::make_unique<SpillLog>(spill_opts);
+    }
+    producer_ = std::make_unique<cppkafka::Producer>(config);
+    poll_thread_ = std::thread([this]
+                               { poll_loop(); });
+    if (spill_)
+        replay_thread_ = std::thread([this]
+                                     { replay_loop(); });
+}
+
+KafkaPublisher::~KafkaPublisher()
+{
+    {
+        std::lock_guard<std::mutex> lock(replay_mtx_);
+        stop_ = true;
+    }
+    replay_cv_.notify_all();
+    if (replay_thread_.joinable())
+        replay_thread_.join();
+    if (poll_thread_.joinable())
+        poll_thread_.join();
+    try
+    {
+        producer_->flush(options_.flush_timeout);
+    }
+    catch (const cppkafka::Exception &ex)
+    {
+        std::cerr << "[KafkaError] 退出时发送剩余消息失败：" << ex.what() << std::endl;
+    }
+}
+
+bool KafkaPublisher::publish(const std::string &key, const std::string &payload)
+{
+    if (!spill_)
+    {
+        if (produce(key, payload, true))
+            return true;
+        failed_++;
+        return false;
+    }
+    // 有落盘队列时不等待：broker 不可用或队列满直接落盘
+    if (!broker_down_ && produce(key, payload, false))
+        return true;
+    return spill(key, payload);
+}
+
+bool KafkaPublisher::spill(const std::string &key, const std::string &payload)
+{
+    if (spill_ && spill_->append(key, payload))
+    {
+        spilled_++;
+        return true;
+    }
+    std::cerr << "[KafkaError] 消息发送失败且无法落盘，已放弃：key=" << key << std::endl;
+    failed_++;
+    return false;
+}
+
+bool KafkaPublisher::produce(const std::string &key, const std::string &payload, bool wait)
+{
+    cppkafka::MessageBuilder builder(options_.topic);
+    if (!key.empty())
+        builder.key(key);
+    builder.payload(payload);
+    for (int i = 0;; ++i)
+    {
+        try
+        {
+            producer_->produce(builder);
+            queued_++;
+            return true;
+        }
+        catch (const cppkafka::HandleException &ex)
+        {
+            if (ex.get_error().get_error() != RD_KAFKA_RESP_ERR__QUEUE_FULL || !wait || i >= kQueueFullRetries)
+            {
+                if (!spill_)
+                    std::cerr << "[KafkaError] 消息入队失败：" << ex.what() << std::endl;
+                return false;
+            }
+        }
+        // 队列满（broker 跟不上），处理一批投递确认后重试
+        producer_->poll(kQueueFullWait);
+    }
+}
+
+void KafkaPublisher::on_delivery(const cppkafka::Message &message)
+{
+    if (!message.get_error())
+    {
+        delivered_++;
+        if (broker_down_.exchange(false))
+            std::cout << "[Kafka] broker 已恢复" << std::endl;
+        return;
+    }
+    // librdkafka 的重试已用尽（超过 message.timeout.ms）
+    std::string key = message.get_key();
+    std::string payload = message.get_payload();
+    if (!spill_)
+    {
+        std::cerr << "[KafkaError] 消息投递失败，已放弃：key=" << key << " 错误：" << message.get_error() << std::endl;
+        failed_++;
+        return;
+    }
+    spill(key, payload);
+}
+
+void KafkaPublisher::poll_loop()
+{
+    while (!stop_)
+    {
+        try
+        {
+            producer_->poll(options_.poll_interval);
+        }
+        catch (const cppkafka::Exception &ex)
+        {
+            std::cerr << "[KafkaError] poll 失败：" << ex.what() << std::endl;
+        }
+    }
+}
+
+void KafkaPublisher::replay_loop()
+{
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(replay_mtx_);
+            replay_cv_.wait_for(lock, options_.replay_interval, [this]
+                                { return stop_.load(); });
+            if (stop_)
+                break;
+        }
+        if (spill_->pendingBytes() == 0 || (broker_down_ && !probe_broker()))
+            continue;
+
+        // 按段回放：整段放入发送队列并全部确认后才删除该段；
+        // 投递失败的消息在投递回调里重新落盘，不会因为删除段而丢失
+        uint64_t id = 0;
+        std::vector<SpillLog::Record> records;
+        while (!stop_ && !broker_down_ && spill_->oldestSegment(id, records))
+        {
+            size_t sent = 0;
+            for (const SpillLog::Record &record : records)
+            {
+                if (!produce(record.key, record.payload, true))
+                    break;
+                sent++;
+            }
+            if (sent < records.size())
+                break; // 队列一直满，保留该段下次重试（已发出的部分会重复，消费端按 uid 同步最新状态，重复无害）
+            try
+            {
+                producer_->flush(options_.flush_timeout);
+            }
+            catch (const cppkafka::Exception &ex)
+            {
+                std::cerr << "[KafkaError] 回放落盘消息等待确认超时：" << ex.what() << std::endl;
+                break;
+            }
+            spill_->removeSegment(id);
+            replayed_ += records.size();
+            std::cout << "[Kafka] 回放落盘段 " << id << "，" << records.size() << " 条消息，剩余 "
+                      << spill_->pendingBytes() << " 字节" << std::endl;
+        }
+    }
+}
+
+bool KafkaPublisher::probe_broker()
+{
+    try
+    {
+        producer_->get_metadata(false, kProbeTimeout);
+    }
+    catch (const cppkafka::Exception &)
+    {
+        return false;
+    }
+    broker_down_ = false;
+    std::cout << "[Kafka] broker 已恢复，开始回放落盘消息" << std::endl;
+    return true;
+}
+
+KafkaPublisher::Stats KafkaPublisher::stats() const
+{
+    Stats s;
+    s.queued = queued_.load();
+    s.delivered = delivered_.load();
+    s.failed = failed_.load();
+    s.in_flight = static_cast<size_t>(producer_->get_out_queue_length());
+    s.spilled = spilled_.load();
+    s.replayed = replayed_.load();
+    s.spill_bytes = spill_ ? spill_->pendingBytes() : 0;
+    s.broker_down = broker_down_.load();
+    return s;
+}
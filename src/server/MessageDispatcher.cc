@@ -49,7 +49,7 @@ void MessageDispatcher::Dispatch(int sessionid, int msg_id, const std::string &d
     {
         MsgHandler handler = it->second;
         pool_.enqueue_with_key((long long)sessionid, [handler, sessionid, data]()
-                               { handler(sessionid, data); });
+                               { handler(sessionid, data); }, msg_id);
     }
     else
     {
@@ -104,6 +104,8 @@ void MessageDispatcher::Zhuce_handle(int sessionid, const std::string &data)
     {
         regresp.set_ok(true);
         regresp.set_uid(user.clientid());
+        // 新 uid 加入过滤器，否则之后查询该玩家会被当作不存在
+        PlayerDataManager::getInstance().addKnownUid(user.clientid());
     }
     else
     {
@@ -148,7 +150,14 @@ void MessageDispatcher::Denglu_handle(int sessionid, const std::string &data)
     {
         // 账号密码正确
         //std::cout << "返回" << std::endl;
-        SessionManager::getinstance().AddUser(uid, SessionManager::getinstance().getSession(sessionid));
+        auto login_session = SessionManager::getinstance().getSession(sessionid);
+        SessionManager::getinstance().AddUser(uid, login_session);
+        if (login_session)
+            login_session->setuid(uid);
+        // 账号可能是其他服务器进程注册的
+        PlayerDataManager::getInstance().addKnownUid(uid);
+        // 在客户端请求之前把玩家数据加载到缓存，首次查看背包/进房间不再冷加载
+        PlayerDataManager::getInstance().prefetchPlayer(uid);
         loginresp.set_ok(true);
     }
     else
@@ -180,8 +189,9 @@ void MessageDispatcher::Backpack_handle(int sessionid, const std::string &data)
     // 获取uid玩家数据
     std::cout << "uid:" << uid << std::endl;
 
-    auto playerdata = PlayerDataManager::getInstance().getPlayer(uid);
-
+    // 异步读取，等待 Redis 回复期间不占用工作线程
+    PlayerDataManager::getInstance().getPlayerAsync(uid, [sessionid](std::shared_ptr<msg::PlayerAttr> playerdata)
+                                                    {
     if (playerdata)
     {
         // 返回数据
@@ -219,7 +229,7 @@ void MessageDispatcher::Backpack_handle(int sessionid, const std::string &data)
             session->send(response_package);
         }
         return; // 如果玩家数据未找到，直接返回
-    }
+    } });
 }
 
 // 用户等级变化消息处理函数
@@ -235,23 +245,17 @@ void MessageDispatcher::AddExp_handle(int sessionid, const std::string &data)
     int uid = req.uid();
     int add_exp = req.exp_add();
 
-    PlayerDataManager &datamanager = PlayerDataManager::getInstance();
-
-    // 更新经验和等级，返回最新属性
-    int new_level = 0;
-    int new_exp = 0;
-    bool leveled_up = false;
-
-    datamanager.updateExepAndLevel(uid, add_exp, new_level, new_exp, leveled_up);
-
+    // 更新经验和等级，异步返回最新属性（等待 Redis 期间不占用工作线程）
+    PlayerDataManager::getInstance().updateExepAndLevel(uid, add_exp, [sessionid, uid](const PlayerDataManager::ExpResult &result)
+                                                        {
     std::cout << "构建返回经验信息" << std::endl;
     // 构造返回消息
     msg::AddExpRsp rsp;
     rsp.set_uid(uid);
-    rsp.set_new_level(new_level);
-    rsp.set_new_exp(new_exp);
-    rsp.set_level_up(leveled_up);
-    rsp.set_success(true);
+    rsp.set_new_level(result.level);
+    rsp.set_new_exp(result.exp);
+    rsp.set_level_up(result.leveled_up);
+    rsp.set_success(result.ok);
 
     // 发送给客户端
     auto session = SessionManager::getinstance().getSession(sessionid);
@@ -262,7 +266,7 @@ void MessageDispatcher::AddExp_handle(int sessionid, const std::string &data)
 
         auto pkg = SessionManager::getinstance().buildMsg(MSG_ADDEXPACK, out);
         session->send(pkg);
-    }
+    } });
 }
 
 // 玩家加入房间
@@ -0,0 +1,135 @@
+#include "MySQLBatchWriter.h"
+#include "UserDatamodel.h"
+
+#include <iostream>
+
+MySQLBatchWriter::MySQLBatchWriter(Options options) : options_(std::move(options))
+{
+    thread_ = std::thread([this]
+                          { run(); });
+}
+
+MySQLBatchWriter::~MySQLBatchWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+}
+
+std::future<bool> MySQLBatchWriter::submit(const msg::PlayerAttr &player)
+{
+    auto promise = std::make_shared<std::promise<bool>>();
+    std::future<bool> result = promise->get_future();
+    submit(player, [promise](bool ok)
+           { promise->set_value(ok); });
+    return result;
+}
+
+void MySQLBatchWriter::submit(const msg::PlayerAttr &player, std::function<void(bool)> done)
+{
+    bool wake;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        // 队列由空变为非空时唤醒写入线程开始计时，攒够一批时唤醒它立即写出
+        bool first = queue_.empty();
+        Pending &pending = queue_[player.uid()];
+        pending.player = player;
+        pending.waiters.push_back(std::move(done));
+        stats_.submitted++;
+        wake = first || queue_.size() >= options_.max_batch;
+    }
+    if (wake)
+        cv_.notify_one();
+}
+
+void MySQLBatchWriter::run()
+{
+    auto last_report = std::chrono::steady_clock::now();
+    size_t reported_flushes = 0;
+    while (true)
+    {
+        std::unordered_map<int, Pending> batch;
+        bool stopping;
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            // 第一个玩家进入队列后最多再等 interval
+            cv_.wait(lock, [this]
+                     { return stop_ || !queue_.empty(); });
+            cv_.wait_for(lock, options_.interval, [this]
+                         { return stop_ || queue_.size() >= options_.max_batch; });
+            batch.swap(queue_);
+            stopping = stop_;
+        }
+        if (!batch.empty())
+            flush(batch);
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_report >= options_.report)
+        {
+            last_report = now;
+            Stats s = stats();
+            if (s.flushes != reported_flushes)
+            {
+                reported_flushes = s.flushes;
+                std::cout << "[MySQLWriter] " << s.submitted << " 次写入合并为 " << s.rows << " 行、" << s.flushes
+                          << " 批，平均每批 " << s.rows / s.flushes << " 行 " << s.total_us / s.flushes << "us，最大 "
+                          << s.max_rows << " 行 " << s.max_us << "us，失败 " << s.failed_flushes << " 批" << std::endl;
+            }
+        }
+        if (stopping)
+            break;
+    }
+}
+
+void MySQLBatchWriter::flush(std::unordered_map<int, Pending> &batch)
+{
+    std::vector<msg::PlayerAttr> players;
+    players.reserve(batch.size());
+    for (const auto &[uid, pending] : batch)
+    {
+        players.push_back(pending.player);
+    }
+    auto start = std::chrono::steady_clock::now();
+    bool ok = UserDatamodel::instance().UpsertUserDataBatch(players);
+    long long us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        stats_.flushes++;
+        if (ok)
+            stats_.rows += players.size();
+        else
+            stats_.failed_flushes++;
+        stats_.last_rows = players.size();
+        stats_.max_rows = std::max(stats_.max_rows, players.size());
+        stats_.last_us = us;
+        stats_.max_us = std::max(stats_.max_us, us);
+        stats_.total_us += us;
+    }
+    if (!ok)
+        std::cerr << "[MySQLWriter] 写入 " << players.size() << " 个玩家失败" << std::endl;
+    for (auto &[uid, pending] : batch)
+    {
+        for (std::function<void(bool)> &waiter : pending.waiters)
+        {
+            try
+            {
+                waiter(ok);
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "[MySQLWriter] 玩家 " << uid << " 回调异常：" << e.what() << std::endl;
+            }
+        }
+    }
+}
+
+MySQLBatchWriter::Stats MySQLBatchWriter::stats()
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    Stats s = stats_;
+    s.pending = queue_.size();
+    return s;
+}
@@ -0,0 +1,278 @@
+#include "PlayerActors.h"
+
+#include <atomic>
+#include <future>
+#include <iostream>
+#include <iterator>
+#include <memory>
+
+namespace
+{
+    // 异步操作的进度：f 返回之前完成的不挂起邮箱
+    enum AsyncPhase
+    {
+        kRunning,   // f 正在执行
+        kFinished,  // f 返回之前已经完成
+        kSuspended, // 邮箱已挂起，等待完成
+    };
+    using AsyncState = std::shared_ptr<std::atomic<int>>;
+
+    // 当前线程正在处理的玩家邮箱（处理中可能嵌套调用其它玩家，所以是栈）
+    thread_local std::vector<int> draining_uids;
+    // 当前执行的消息能否挂起邮箱：drain 中可以；call 顺带执行时调用线程还要接着执行自己的操作，不行
+    thread_local bool suspendable = false;
+    // 当前消息发起的未完成异步操作，由 drain 放回剩余消息后挂起邮箱
+    thread_local AsyncState suspending;
+}
+
+PlayerActors::PlayerActors() : shards_(kShards)
+{
+}
+
+bool PlayerActors::is_draining(int uid)
+{
+    return std::find(draining_uids.begin(), draining_uids.end(), uid) != draining_uids.end();
+}
+
+void PlayerActors::post(int uid, std::function<void()> func)
+{
+    if (!pool_)
+    {
+        if (push(uid, std::move(func)))
+            drain(uid);
+        return;
+    }
+    {
+        Shard &shard = shard_of(uid);
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        Mailbox &mailbox = shard.mailboxes[uid];
+        mailbox.messages.push_back(std::move(func));
+        if (mailbox.running || mailbox.scheduled)
+            return; // 已有线程在处理或已安排处理任务，消息会被顺带执行
+        // 只记录已安排，不占有邮箱：任务开始执行之前 call 可以在自己的线程上接手
+        mailbox.scheduled = true;
+    }
+    pool_->enqueue_with_key(uid, [this, uid]
+                            { run_scheduled(uid); });
+}
+
+void PlayerActors::post_async(int uid, std::function<void(Done done)> f)
+{
+    post(uid, [this, uid, f = std::move(f)]
+         {
+        if (!suspendable)
+        {
+            // 调用线程还要接着执行后面的操作，就地等待完成
+            auto finished = std::make_shared<std::promise<void>>();
+            std::future<void> wait = finished->get_future();
+            f([finished]
+              { finished->set_value(); });
+            wait.wait();
+            return;
+        }
+        auto state = std::make_shared<std::atomic<int>>(kRunning);
+        f([this, uid, state]
+          {
+            int expected = kRunning;
+            if (state->compare_exchange_strong(expected, kFinished))
+                return; // 邮箱还没挂起，drain 继续处理
+            resume(uid); });
+        suspending = std::move(state); });
+}
+
+void PlayerActors::resume(int uid)
+{
+    Shard &shard = shard_of(uid);
+    {
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        auto it = shard.mailboxes.find(uid);
+        Mailbox &mailbox = it->second;
+        if (mailbox.waiters == 0 && mailbox.messages.empty())
+        {
+            if (mailbox.scheduled)
+                mailbox.running = false;
+            else
+                shard.mailboxes.erase(it);
+            return;
+        }
+        if (pool_ || mailbox.waiters > 0)
+        {
+            // 释放邮箱：等待的 call 接手，或者安排处理任务（同 post，任务开始之前 call 也可以接手）
+            mailbox.running = false;
+            shard.released.notify_all();
+            if (mailbox.waiters > 0 || mailbox.scheduled)
+                return;
+            mailbox.scheduled = true;
+        }
+    }
+    if (pool_)
+        pool_->enqueue_with_key(uid, [this, uid]
+                                { run_scheduled(uid); });
+    else
+        drain(uid); // 没有线程池：仍占有邮箱，在当前线程继续处理
+}
+
+void PlayerActors::run_scheduled(int uid)
+{
+    {
+        Shard &shard = shard_of(uid);
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        auto it = shard.mailboxes.find(uid);
+        Mailbox &mailbox = it->second;
+        mailbox.scheduled = false;
+        if (mailbox.running)
+            return; // call 的调用线程正在处理，剩余消息由它顺带执行
+        if (mailbox.messages.empty())
+        {
+            // 消息已被 call 的调用线程处理完
+            if (mailbox.waiters == 0)
+                shard.mailboxes.erase(it);
+            return;
+        }
+        mailbox.running = true;
+    }
+    drain(uid);
+}
+
+size_t PlayerActors::size() const
+{
+    size_t total = 0;
+    for (const Shard &shard : shards_)
+    {
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        total += shard.mailboxes.size();
+    }
+    return total;
+}
+
+void PlayerActors::acquire(int uid)
+{
+    Shard &shard = shard_of(uid);
+    std::unique_lock<std::mutex> lock(shard.mtx);
+    // 有等待者时邮箱不会被回收，引用在等待期间保持有效
+    Mailbox &mailbox = shard.mailboxes[uid];
+    if (mailbox.running)
+    {
+        mailbox.waiters++;
+        shard.released.wait(lock, [&mailbox]
+                            { return !mailbox.running; });
+        mailbox.waiters--;
+    }
+    mailbox.running = true;
+}
+
+void PlayerActors::begin_inline(int uid)
+{
+    acquire(uid);
+    draining_uids.push_back(uid);
+    // 先执行排在前面的消息，保持投递顺序
+    run_pending(uid);
+}
+
+void PlayerActors::end_inline(int uid)
+{
+    draining_uids.pop_back();
+    drain(uid);
+}
+
+bool PlayerActors::push(int uid, std::function<void()> func)
+{
+    Shard &shard = shard_of(uid);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    Mailbox &mailbox = shard.mailboxes[uid];
+    mailbox.messages.push_back(std::move(func));
+    if (mailbox.running)
+        return false;
+    mailbox.running = true;
+    return true;
+}
+
+void PlayerActors::run_pending(int uid)
+{
+    Shard &shard = shard_of(uid);
+    for (;;)
+    {
+        std::vector<std::function<void()>> batch;
+        {
+            std::lock_guard<std::mutex> lock(shard.mtx);
+            Mailbox &mailbox = shard.mailboxes.find(uid)->second;
+            if (mailbox.messages.empty())
+                return;
+            batch.swap(mailbox.messages);
+        }
+        run_batch(uid, batch, false);
+    }
+}
+
+void PlayerActors::drain(int uid)
+{
+    Shard &shard = shard_of(uid);
+    draining_uids.push_back(uid);
+    for (;;)
+    {
+        std::vector<std::function<void()>> batch;
+        {
+            std::lock_guard<std::mutex> lock(shard.mtx);
+            auto it = shard.mailboxes.find(uid);
+            Mailbox &mailbox = it->second;
+            if (mailbox.waiters > 0)
+            {
+                // 有 call 在等待：让出，剩余消息由接手的线程先执行，持续的 post 不会让它一直等下去
+                mailbox.running = false;
+                shard.released.notify_all();
+                break;
+            }
+            if (mailbox.messages.empty())
+            {
+                // 邮箱已空，回收；已安排的处理任务还会访问它时只释放
+                if (mailbox.scheduled)
+                    mailbox.running = false;
+                else
+                    shard.mailboxes.erase(it);
+                break;
+            }
+            batch.swap(mailbox.messages);
+        }
+        if (!run_batch(uid, batch, true))
+            continue;
+        // 异步操作挂起邮箱：剩余消息放回队首，之后才允许完成回调释放邮箱
+        {
+            std::lock_guard<std::mutex> lock(shard.mtx);
+            Mailbox &mailbox = shard.mailboxes.find(uid)->second;
+            mailbox.messages.insert(mailbox.messages.begin(), std::make_move_iterator(batch.begin()),
+                                    std::make_move_iterator(batch.end()));
+        }
+        AsyncState state = std::move(suspending);
+        int expected = kRunning;
+        if (state->compare_exchange_strong(expected, kSuspended))
+            break; // 邮箱保持占用，由完成回调 resume
+        // 放回期间已经完成，继续处理
+    }
+    draining_uids.pop_back();
+}
+
+bool PlayerActors::run_batch(int uid, std::vector<std::function<void()>> &batch, bool can_suspend)
+{
+    // 在锁外按顺序执行
+    for (size_t i = 0; i < batch.size(); ++i)
+    {
+        bool outer = suspendable;
+        suspendable = can_suspend;
+        try
+        {
+            batch[i]();
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "[PlayerActor] 玩家 " << uid << " 消息处理异常：" << e.what() << std::endl;
+        }
+        suspendable = outer;
+        if (suspending)
+        {
+            batch.erase(batch.begin(), batch.begin() + i + 1);
+            return true;
+        }
+    }
+    batch.clear();
+    return false;
+}
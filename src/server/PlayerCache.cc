@@ -0,0 +1,250 @@
+#include "PlayerCache.h"
+
+#include <algorithm>
+
+namespace
+{
+    const char *const kFieldNames[PlayerCache::FIELD_COUNT] = {"level", "exp", "hp", "mp", "coin", "x", "y", "z"};
+}
+
+PlayerCache::PlayerCache(size_t budget_bytes)
+    : shards_(kShards),
+      capacity_per_shard_(std::max<size_t>(1, budget_bytes / kEntryBytes / kShards))
+{
+}
+
+bool PlayerCache::get(int uid, msg::PlayerAttr &out)
+{
+    Shard &shard = shard_of(uid);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    auto it = shard.entries.find(uid);
+    if (it == shard.entries.end())
+        return false;
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second.second);
+    out = it->second.first.attr;
+    return true;
+}
+
+void PlayerCache::put(const msg::PlayerAttr &attr)
+{
+    int uid = attr.uid();
+    Shard &shard = shard_of(uid);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    auto it = shard.entries.find(uid);
+    if (it != shard.entries.end())
+    {
+        // 内存中的数据不比 Redis 旧，只刷新 LRU
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second.second);
+        return;
+    }
+
+    // 超出预算，从 LRU 尾部淘汰干净的玩家
+    for (size_t scanned = 0; shard.entries.size() >= capacity_per_shard_ && !shard.lru.empty() && scanned < kEvictScan; ++scanned)
+    {
+        auto vit = shard.entries.find(shard.lru.back());
+        if (vit->second.first.dirty || vit->second.first.writing)
+        {
+            // 等写回确认后再淘汰，先挪到头部，避免堵住尾部的干净条目
+            shard.lru.splice(shard.lru.begin(), shard.lru, vit->second.second);
+            continue;
+        }
+        shard.lru.pop_back();
+        shard.entries.erase(vit);
+    }
+
+    shard.lru.push_front(uid);
+    shard.entries.emplace(uid, std::make_pair(Entry{attr, 0}, shard.lru.begin()));
+}
+
+bool PlayerCache::update(int uid, Field field, int value)
+{
+    Shard &shard = shard_of(uid);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    auto it = shard.entries.find(uid);
+    if (it == shard.entries.end())
+        return false;
+    Entry &entry = it->second.first;
+    setField(entry.attr, field, value);
+    entry.dirty |= 1u << field;
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second.second);
+    return true;
+}
+
+bool PlayerCache::refreshExpAndLevel(int uid, int exp, int level)
+{
+    Shard &shard = shard_of(uid);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    auto it = shard.entries.find(uid);
+    if (it == shard.entries.end())
+        return false;
+    Entry &entry = it->second.first;
+    entry.attr.set_exp(exp);
+    entry.attr.set_level(level);
+    entry.dirty &= ~((1u << EXP) | (1u << LEVEL));
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second.second);
+    return true;
+}
+
+std::vector<int> PlayerCache::dirtyUids() const
+{
+    std::vector<int> uids;
+    for (const Shard &shard : shards_)
+    {
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        for (const auto &[uid, slot] : shard.entries)
+        {
+            if (slot.first.dirty)
+                uids.push_back(uid);
+        }
+    }
+    return uids;
+}
+
+bool PlayerCache::takeDirty(int uid, Dirty &out)
+{
+    Shard &shard = shard_of(uid);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    auto it = shard.entries.find(uid);
+    if (it == shard.entries.end() || it->second.first.dirty == 0)
+        return false;
+    Entry &entry = it->second.first;
+    out = {uid, entry.attr, entry.dirty};
+    entry.dirty = 0;
+    entry.writing++;
+    return true;
+}
+
+void PlayerCache::writeDone(int uid, uint32_t failed_mask)
+{
+    Shard &shard = shard_of(uid);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    auto it = shard.entries.find(uid);
+    if (it != shard.entries.end())
+    {
+        Entry &entry = it->second.first;
+        if (entry.writing)
+            entry.writing--;
+        entry.dirty |= failed_mask;
+    }
+}
+
+bool PlayerCache::remove(int uid, Dirty &out)
+{
+    Shard &shard = shard_of(uid);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    auto it = shard.entries.find(uid);
+    if (it == shard.entries.end())
+        return false;
+    bool dirty = it->second.first.dirty != 0;
+    if (dirty)
+    {
+        out = {uid, it->second.first.attr, it->second.first.dirty};
+    }
+    shard.lru.erase(it->second.second);
+    shard.entries.erase(it);
+    return dirty;
+}
+
+size_t PlayerCache::size() const
+{
+    size_t total = 0;
+    for (const Shard &shard : shards_)
+    {
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        total += shard.entries.size();
+    }
+    return total;
+}
+
+PlayerCache::Field PlayerCache::fieldOf(const std::string &name)
+{
+    for (int i = 0; i < FIELD_COUNT; ++i)
+    {
+        if (name == kFieldNames[i])
+            return static_cast<Field>(i);
+    }
+    return FIELD_COUNT;
+}
+
+const char *PlayerCache::fieldName(Field field)
+{
+    return kFieldNames[field];
+}
+
+void PlayerCache::setField(msg::PlayerAttr &attr, Field field, int value)
+{
+    switch (field)
+    {
+    case LEVEL:
+        attr.set_level(value);
+        break;
+    case EXP:
+        attr.set_exp(value);
+        break;
+    case HP:
+        attr.set_hp(value);
+        break;
+    case MP:
+        attr.set_mp(value);
+        break;
+    case COIN:
+        attr.set_coin(value);
+        break;
+    case X:
+        attr.set_x(static_cast<float>(value));
+        break;
+    case Y:
+        attr.set_y(static_cast<float>(value));
+        break;
+    case Z:
+        attr.set_z(static_cast<float>(value));
+        break;
+    default:
+        break;
+    }
+}
+
+std::string PlayerCache::fieldValue(const msg::PlayerAttr &attr, Field field)
+{
+    switch (field)
+    {
+    case LEVEL:
+        return std::to_string(attr.level());
+    case EXP:
+        return std::to_string(attr.exp());
+    case HP:
+        return std::to_string(attr.hp());
+    case MP:
+        return std::to_string(attr.mp());
+    case COIN:
+        return std::to_string(attr.coin());
+    case X:
+        return std::to_string(attr.x());
+    case Y:
+        return std::to_string(attr.y());
+    case Z:
+        return std::to_string(attr.z());
+    default:
+        return "";
+    }
+}
+
+void PlayerCache::copyFields(msg::PlayerAttr &dst, const msg::PlayerAttr &src, uint32_t mask)
+{
+    if (mask & (1u << LEVEL))
+        dst.set_level(src.level());
+    if (mask & (1u << EXP))
+        dst.set_exp(src.exp());
+    if (mask & (1u << HP))
+        dst.set_hp(src.hp());
+    if (mask & (1u << MP))
+        dst.set_mp(src.mp());
+    if (mask & (1u << COIN))
+        dst.set_coin(src.coin());
+    if (mask & (1u << X))
+        dst.set_x(src.x());
+    if (mask & (1u << Y))
+        dst.set_y(src.y());
+    if (mask & (1u << Z))
+        dst.set_z(src.z());
+}
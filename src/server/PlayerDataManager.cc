@@ -1,8 +1,47 @@
 #include "PlayerDataManager.h"
 #include "UserDatamodel.h"
+#include "Usermodel.h"
+#include "PlayerEventLog.h"
 
 #include <unordered_map>
+#include <unordered_set>
+#include <iterator>
+#include <stdexcept>
+#include <cstring>
+#include <deque>
+#include <algorithm>
+
+// L1 缓存内存预算与脏数据写回周期
+static const size_t kPlayerCacheBudget = 64 * 1024 * 1024;
+static const std::chrono::milliseconds kWriteBackInterval(1000);
+// 已知 uid 过滤器：预期容量与误判率、负缓存有效期、分段加载的大小与增量刷新周期
+static const size_t kExpectedUids = 4 * 1024 * 1024;
+static const double kUidFalsePositiveRate = 0.01;
+static const std::chrono::milliseconds kNegativeTtl(30000);
+static const int kUidChunk = 10000;
+static const std::chrono::milliseconds kUidRefreshInterval(30000);
+// 增量刷新时回看游标之前的 uid 数：自增 uid 的事务可能乱序提交，较小的 uid 晚于较大的 uid 可见
+static const int kUidLookback = 1000;
+// 下线玩家的 Redis 记录保留时间（期间重新登录仍命中 Redis）
+static const std::chrono::seconds kLogoutTtl(600);
+// 全量同步：周期、每次 SCAN 的数量、MySQL 写入限速与进度日志间隔
+static const std::chrono::milliseconds kSyncAllInterval(60 * 60 * 1000);
+static const long long kSyncScanCount = 500;
+static const size_t kSyncRowsPerSecond = 5000;
+static const size_t kSyncReportEvery = 50000;
+// 缓存重建的进度日志间隔与待写入页数上限
+static const size_t kRebuildReportEvery = 100000;
+static const size_t kRebuildMaxPages = 16;
+// kafka 玩家变化事件的格式版本
+static const uint32_t kEventVersion = 1;
+
+static std::string redisKey(int uid)
+{
+    return "player:" + std::to_string(uid);
+}
+
 PlayerDataManager::PlayerDataManager()
+    : cache_(kPlayerCacheBudget), known_uids_(kExpectedUids, kUidFalsePositiveRate, kNegativeTtl)
 {
     // 配置Redis单个连接的信息
     sw::redis::ConnectionOptions redis_opts;
@@ -17,12 +56,20 @@ PlayerDataManager::PlayerDataManager()
 
     // 创建带连接池的Redis客户端
     redis_ = std::make_shared<sw::redis::Redis>(redis_opts, pool_opts);
+    // 玩家数据读写都经过批量层，并发请求合并到同一个 pipeline
+    batcher_ = std::make_unique<RedisBatcher>(redis_);
 
-    // 配置KafKa
-    cppkafka::Configuration kafka_config = {
-        {"metadata.broker.list", "127.0.0.1:9092"}};
-    producer_ = std::make_shared<cppkafka::Producer>(kafka_config);
-    topic_ = "playerdata_update"; // 玩家数据更新的消息都会发送到该topic
+    // 配置KafKa：异步攒批发送，后台线程处理投递确认
+    KafkaPublisher::Options kafka_opts;
+    kafka_opts.brokers = "127.0.0.1:9092";
+    kafka_opts.topic = "playerdata_update"; // 玩家数据更新的消息都会发送到该topic
+    kafka_opts.linger_ms = 5;
+    kafka_opts.batch_messages = 1000;
+    // broker 不可用时更新事件先落到本地，恢复后回放，不丢 MySQL 同步
+    kafka_opts.spill_dir = "spill/playerdata_update";
+    publisher_ = std::make_unique<KafkaPublisher>(kafka_opts);
+    // 大量玩家同时下线时合并成少量事务写入 MySQL
+    mysql_writer_ = std::make_unique<MySQLBatchWriter>(MySQLBatchWriter::Options{});
 }
 
 PlayerDataManager &PlayerDataManager::getInstance()
@@ -31,9 +78,305 @@ PlayerDataManager &PlayerDataManager::getInstance()
     return instance;
 }
 
+void PlayerDataManager::bindWorkerPool(ThreadPool &pool)
+{
+    actors_.bind(&pool);
+    // 定期把 L1 中的脏数据写回 Redis
+    pool.enqueue_every(0, kWriteBackInterval, [this]
+                       { flushDirtyPlayers(); });
+    // 只加载上次之后新注册的 uid（启动时加载失败则分段补全），不会长时间占用工作线程
+    pool.enqueue_every(0, kUidRefreshInterval, [this]
+                       { refreshKnownUids(); });
+    // 定时全量同步只负责启动后台线程，立即返回
+    pool.enqueue_every(0, kSyncAllInterval, [this]
+                       { syncAll(); });
+}
+
+void PlayerDataManager::unbindWorkerPool()
+{
+    actors_.bind(nullptr);
+}
+
+void PlayerDataManager::loadKnownUids()
+{
+    int cursor = 0;
+    for (;;)
+    {
+        std::vector<int> uids;
+        if (!Usermodel::getinstance().loadUids(cursor, kUidChunk, uids))
+        {
+            // 不拦截任何 uid，等增量刷新完整扫描一遍后再启用
+            std::cerr << "[UidFilter] 加载 uid 失败，暂不启用过滤" << std::endl;
+            return;
+        }
+        for (int uid : uids)
+        {
+            known_uids_.add(uid);
+        }
+        if (!uids.empty())
+            cursor = uids.back();
+        if (uids.size() < static_cast<size_t>(kUidChunk))
+            break;
+    }
+    // 之后的刷新从最大的 uid 往后读（uid 自增，新注册的总在后面）
+    refresh_cursor_ = cursor;
+    known_uids_.setReady();
+    std::cout << "[UidFilter] 已加载 " << known_uids_.added() << " 个 uid" << std::endl;
+}
+
+// 增量刷新：从游标之前 kUidLookback 个 uid 处开始读，补上晚提交的较小 uid（重复加入过滤器无影响）。
+// 启动时已加载完整时游标在表尾，每次只读到其他进程新注册的玩家；
+// 启动时加载失败则从头分段补全，读到表尾后启用过滤，之后同样只读新注册的
+void PlayerDataManager::refreshKnownUids()
+{
+    int cursor = refresh_cursor_;
+    std::vector<int> uids;
+    if (!Usermodel::getinstance().loadUids(std::max(0, cursor - kUidLookback), kUidChunk, uids))
+        return;
+    for (int uid : uids)
+    {
+        known_uids_.add(uid);
+    }
+    if (!uids.empty() && uids.back() > cursor)
+        refresh_cursor_ = uids.back();
+    if (uids.size() < static_cast<size_t>(kUidChunk) && !known_uids_.ready())
+        known_uids_.setReady();
+}
+
+void PlayerDataManager::addKnownUid(int uid)
+{
+    known_uids_.add(uid);
+}
+
+void PlayerDataManager::setRedisFormat(RedisFormat format)
+{
+    format_ = format;
+}
+
+// 启动时把 Lua 脚本加载到 Redis，之后用 EVALSHA 调用
+void PlayerDataManager::loadScripts()
+{
+    for (int i = 0; i < PlayerScripts::SCRIPT_COUNT; ++i)
+    {
+        try
+        {
+            std::string sha = redis_->script_load(PlayerScripts::source(static_cast<PlayerScripts::Id>(i)));
+            std::lock_guard<std::mutex> lock(script_mtx_);
+            script_sha_[i] = sha;
+        }
+        catch (const sw::redis::Error &err)
+        {
+            std::cerr << "[RedisError] 加载 Lua 脚本 " << i << " 失败：" << err.what() << std::endl;
+        }
+    }
+}
+
+std::string PlayerDataManager::scriptSha(PlayerScripts::Id id)
+{
+    std::lock_guard<std::mutex> lock(script_mtx_);
+    return script_sha_[id];
+}
+
+bool PlayerDataManager::isNoScript(const std::string &error)
+{
+    return error.rfind("NOSCRIPT", 0) == 0;
+}
+
+// Redis 的脚本缓存丢失（重启或故障切换）：清掉本地的 SHA1，之后直接用 EVAL，并只安排一次重新加载
+void PlayerDataManager::scriptMissing(int uid, PlayerScripts::Id id, const std::string &sha)
+{
+    {
+        std::lock_guard<std::mutex> lock(script_mtx_);
+        if (script_sha_[id] != sha)
+            return; // 已经处理过
+        script_sha_[id].clear();
+    }
+    actors_.post(uid, [this]
+                 { loadScripts(); });
+}
+
+// 脚本不在 Redis 缓存中（未加载或 Redis 重启）时改用 EVAL，EVAL 会重新缓存脚本
+template <typename Run>
+void PlayerDataManager::runScript(PlayerScripts::Id id, Run run)
+{
+    std::string sha = scriptSha(id);
+    if (!sha.empty())
+    {
+        try
+        {
+            run(sha, true);
+            return;
+        }
+        catch (const sw::redis::ReplyError &err)
+        {
+            if (!isNoScript(err.what()))
+                throw;
+        }
+    }
+    run(std::string(PlayerScripts::source(id)), false);
+}
+
+// 在 uid 对应的异步连接上执行脚本，与该玩家的写回保持顺序；脚本未缓存时在同一连接上退回 EVAL
+void PlayerDataManager::evalAsync(AsyncRedis &async_redis, int uid, PlayerScripts::Id id, const std::string &key,
+                                  const std::vector<std::string> &args, AsyncRedis::Callback done)
+{
+    auto argv = [key, args](const std::string &command, const std::string &script)
+    {
+        std::vector<std::string> argv = {command, script, "1", key};
+        argv.insert(argv.end(), args.begin(), args.end());
+        return argv;
+    };
+    std::string sha = scriptSha(id);
+    if (sha.empty())
+    {
+        async_redis.command(uid, argv("EVAL", PlayerScripts::source(id)), std::move(done));
+        return;
+    }
+    async_redis.command(uid, argv("EVALSHA", sha), [this, &async_redis, uid, id, sha, argv, done](AsyncRedis::Reply reply)
+                        {
+        if (reply.type == AsyncRedis::Reply::ERROR && isNoScript(reply.str))
+        {
+            scriptMissing(uid, id, sha);
+            async_redis.command(uid, argv("EVAL", PlayerScripts::source(id)), done);
+            return;
+        }
+        done(std::move(reply)); });
+}
+
+// 同上，等待结果（超时由 AsyncRedis 保证）
+AsyncRedis::Reply PlayerDataManager::evalAsync(AsyncRedis &async_redis, int uid, PlayerScripts::Id id,
+                                               const std::string &key, const std::vector<std::string> &args)
+{
+    auto reply = std::make_shared<std::promise<AsyncRedis::Reply>>();
+    std::future<AsyncRedis::Reply> result = reply->get_future();
+    evalAsync(async_redis, uid, id, key, args, [reply](AsyncRedis::Reply r)
+              { reply->set_value(std::move(r)); });
+    return result.get();
+}
+
+void PlayerDataManager::bindAsyncRedis(AsyncRedis *async_redis)
+{
+    async_redis_ = async_redis;
+}
+
+// 异步获取玩家数据：L1 命中直接回调；否则异步读 Redis，不占用工作线程等待。
+// 读取期间占有该玩家的邮箱：放入 L1 之前不会有下线或修改插进来，不会把下线前读到的旧数据放回 L1。
+// Redis 未命中（需要查 MySQL）或出错时退回同步加载路径（同样在玩家邮箱里执行）
+void PlayerDataManager::getPlayerAsync(int uid, std::function<void(std::shared_ptr<msg::PlayerAttr>)> done)
+{
+    auto playerdata = std::make_shared<msg::PlayerAttr>();
+    if (cache_.get(uid, *playerdata))
+    {
+        done(playerdata);
+        return;
+    }
+    if (!known_uids_.mayExist(uid))
+    {
+        done(nullptr);
+        return;
+    }
+    auto load_sync = [this, uid, done]
+    {
+        actors_.post(uid, [this, uid, done]
+                     { done(getPlayer(uid)); });
+    };
+    AsyncRedis *async_redis = async_redis_;
+    if (!async_redis)
+    {
+        load_sync();
+        return;
+    }
+
+    actors_.post_async(uid, [this, uid, playerdata, done, load_sync, async_redis](PlayerActors::Done release)
+                       {
+        // 排队期间可能已被其他操作加载到 L1
+        if (cache_.get(uid, *playerdata))
+        {
+            release();
+            done(playerdata);
+            return;
+        }
+        readRecordAsync(*async_redis, uid, [this, uid, playerdata, done, load_sync, release](ReadResult result, const msg::PlayerAttr &record)
+                        {
+            // 在 io 线程上执行，邮箱仍由本操作占有
+            if (result == ReadResult::FOUND)
+            {
+                *playerdata = record;
+                cache_.put(*playerdata);
+            }
+            release();
+            if (result == ReadResult::CORRUPT)
+                done(nullptr);
+            else if (result == ReadResult::FOUND)
+                done(playerdata);
+            else
+                load_sync(); }); });
+}
+
+// 异步读取一个玩家的记录（回调在 io 线程上执行）。迁移期间 GET 遇到旧的 hash 记录时在同一连接上改用 HGETALL
+void PlayerDataManager::readRecordAsync(AsyncRedis &async_redis, int uid,
+                                        std::function<void(ReadResult, const msg::PlayerAttr &)> done)
+{
+    auto decode = [uid, done](const AsyncRedis::Reply &reply)
+    {
+        msg::PlayerAttr record;
+        record.set_uid(uid);
+        ReadResult result = ReadResult::FAILED;
+        try
+        {
+            if (reply.type == AsyncRedis::Reply::STRING)
+            {
+                result = PlayerRecord::decode(reply.str, record) ? ReadResult::FOUND : ReadResult::MISSING;
+            }
+            else if (reply.type == AsyncRedis::Reply::ARRAY)
+            {
+                RedisBatcher::Hash data;
+                for (size_t i = 0; i + 1 < reply.elements.size(); i += 2)
+                {
+                    data[reply.elements[i].str] = reply.elements[i + 1].str;
+                }
+                result = !data.empty() && PlayerRecord::fromHash(data, record) ? ReadResult::FOUND : ReadResult::MISSING;
+            }
+            else if (reply.type == AsyncRedis::Reply::NIL)
+            {
+                result = ReadResult::MISSING;
+            }
+            else
+            {
+                std::cerr << "[RedisError] 读取玩家 " << uid << " 失败：" << reply.error() << std::endl;
+            }
+        }
+        catch (const std::exception &err)
+        {
+            // 记录损坏（字段不是数字等）
+            std::cerr << "[RedisError] 玩家 " << uid << " 数据解析失败：" << err.what() << std::endl;
+            result = ReadResult::CORRUPT;
+        }
+        done(result, record);
+    };
+    RedisFormat format = format_;
+    if (format == RedisFormat::HASH)
+    {
+        async_redis.command(uid, {"HGETALL", redisKey(uid)}, decode);
+        return;
+    }
+    async_redis.command(uid, {"GET", redisKey(uid)}, [&async_redis, uid, format, decode](AsyncRedis::Reply reply)
+                        {
+        if (format == RedisFormat::MIGRATE && reply.type == AsyncRedis::Reply::ERROR &&
+            reply.str.rfind("WRONGTYPE", 0) == 0)
+        {
+            async_redis.command(uid, {"HGETALL", redisKey(uid)}, decode);
+            return;
+        }
+        decode(reply); });
+}
+
 // 玩家登录获取数据
 std::shared_ptr<msg::PlayerAttr> PlayerDataManager::loadPlayerData(int uid)
 {
+    // 在玩家邮箱上执行，避免同一新玩家被并发插入两次（内部的 getPlayer 直接复用当前邮箱）
+    return actors_.call(uid, [&]() -> std::shared_ptr<msg::PlayerAttr>
+                        {
     auto player = getPlayer(uid);
     if (!player)
     {
@@ -53,373 +396,1105 @@ std::shared_ptr<msg::PlayerAttr> PlayerDataManager::loadPlayerData(int uid)
         // 插入新玩家数据到 MySQL
         if (UserDatamodel::instance().InsertUserData(*playerdata))
         {
-
-            // 将多个字段和值存入 std::map 中
-            std::unordered_map<std::string, std::string> player_data = {
-                {"level", std::to_string(playerdata->level())},
-                {"exp", std::to_string(playerdata->exp())},
-                {"hp", std::to_string(playerdata->hp())},
-                {"mp", std::to_string(playerdata->mp())},
-                {"coin", std::to_string(playerdata->coin())},
-                {"x", std::to_string(playerdata->x())},
-                {"y", std::to_string(playerdata->y())},
-                {"z", std::to_string(playerdata->z())}};
-            std::string redis_key = "player:" + std::to_string(uid);
-            // 使用 hset 方法将多个字段及其值保存到 Redis
-            redis_->hset(redis_key, player_data.begin(), player_data.end());
+            known_uids_.add(uid);
+            // 保存到 Redis
+            writeRecords({playerdata.get()});
+            cache_.put(*playerdata);
         }
         return playerdata;
     }
 
-    return player;
+    return player; });
 }
 
-// 获取玩家数据
-std::shared_ptr<msg::PlayerAttr> PlayerDataManager::getPlayer(int uid)
+// 登录预取：在玩家邮箱里排队执行，不占用登录请求的处理时间；客户端随后的查看/进房间直接命中 L1
+void PlayerDataManager::prefetchPlayer(int uid)
 {
-    // 获取玩家级互斥锁（保证单个玩家线程安全）
-    std::shared_ptr<std::mutex> player_mtx;
-    // 初始化玩家级 mutex
+    auto cancelled = std::make_shared<std::atomic<bool>>(false);
     {
-        std::lock_guard<std::mutex> lock(mtx_map_);
-        if (player_mutex_map_.find(uid) == player_mutex_map_.end())
+        std::lock_guard<std::mutex> lock(prefetch_mtx_);
+        if (!prefetches_.emplace(uid, cancelled).second)
+            return; // 已有在途预取
+    }
+    actors_.post(uid, [this, uid, cancelled]
+                 {
+        // 排队期间玩家已断开则跳过，不再产生 I/O
+        if (!*cancelled)
         {
-            player_mutex_map_.emplace(uid, std::make_shared<std::mutex>());
+            msg::PlayerAttr cached;
+            if (!cache_.get(uid, cached) && loadPlayerData(uid))
+                std::cout << "[Prefetch] 玩家 " << uid << " 数据已预取" << std::endl;
         }
-        player_mtx = player_mutex_map_[uid];
+        std::lock_guard<std::mutex> lock(prefetch_mtx_);
+        auto it = prefetches_.find(uid);
+        if (it != prefetches_.end() && it->second == cancelled)
+            prefetches_.erase(it); });
+}
+
+void PlayerDataManager::cancelPrefetch(int uid)
+{
+    std::lock_guard<std::mutex> lock(prefetch_mtx_);
+    auto it = prefetches_.find(uid);
+    if (it == prefetches_.end())
+        return;
+    *it->second = true;
+    prefetches_.erase(it);
+}
+
+// 获取玩家数据
+std::shared_ptr<msg::PlayerAttr> PlayerDataManager::getPlayer(int uid)
+{
+    // 在线玩家直接从 L1 返回，不经过邮箱和 Redis
+    std::shared_ptr<msg::PlayerAttr> playerdata = std::make_shared<msg::PlayerAttr>();
+    if (cache_.get(uid, *playerdata))
+    {
+        return playerdata;
     }
+    // 一定不存在的 uid 直接返回，不访问 Redis 和 MySQL
+    if (!known_uids_.mayExist(uid))
+        return nullptr;
+    // 同一玩家的并发未命中共享一次加载（在玩家邮箱上执行）
+    return loader_.loadOnce(uid, [&]() -> std::shared_ptr<msg::PlayerAttr>
+                            {
     // 先尝试从缓存中读取
-    std::string redis_key = "player:" + std::to_string(uid);
-    std::shared_ptr<msg::PlayerAttr> playerdata = std::make_shared<msg::PlayerAttr>();
     playerdata->set_uid(uid);
-    std::lock_guard<std::mutex> lock(*player_mtx);
     // 判断是否在缓存中
-    if (redis_->exists(redis_key))
+    if (readRecord(uid, *playerdata))
     {
         std::cout << "从Redis中读取数据" << std::endl;
-        // 在,把数据读出
-        std::unordered_map<std::string, std::string> data;
-        redis_->hgetall(redis_key, std::inserter(data, data.end())); // 获取Redis中key所对应的值
-        // 遍历map获取数据
-        playerdata->set_level(std::stoi(data["level"]));
-        playerdata->set_exp(std::stoi(data["exp"]));
-        playerdata->set_hp(std::stoi(data["hp"]));
-        playerdata->set_mp(std::stoi(data["mp"]));
-        playerdata->set_coin(std::stoi(data["coin"]));
-        playerdata->set_x(std::stof(data["x"]));
-        playerdata->set_y(std::stof(data["y"]));
-        playerdata->set_z(std::stof(data["z"]));
+        cache_.put(*playerdata);
         return playerdata;
     }
 
     // 不在缓存中，从数据库查询，并更新缓存；
-    if (UserDatamodel::instance().QueryUserData(*playerdata))
+    bool not_found = false;
+    if (UserDatamodel::instance().QueryUserData(*playerdata, &not_found))
     {
         // 查询成功，更新缓存
-        // 将多个字段和值存入 std::map 中
-        std::unordered_map<std::string, std::string> player_data = {
-            {"level", std::to_string(playerdata->level())},
-            {"exp", std::to_string(playerdata->exp())},
-            {"hp", std::to_string(playerdata->hp())},
-            {"mp", std::to_string(playerdata->mp())},
-            {"coin", std::to_string(playerdata->coin())},
-            {"x", std::to_string(playerdata->x())},
-            {"y", std::to_string(playerdata->y())},
-            {"z", std::to_string(playerdata->z())}};
-
-        // 使用 hset 方法将多个字段及其值保存到 Redis
-        redis_->hset(redis_key, player_data.begin(), player_data.end());
+        writeRecords({playerdata.get()});
+        cache_.put(*playerdata);
         return playerdata;
     }
 
     // ⬅️ **现在这个条件是正确的了！**
     std::cout << "不存在玩家数据" << std::endl;
+    // 确认不存在（不是查询出错）才记入负缓存
+    if (not_found)
+        known_uids_.markMissing(uid);
 
     // 构造错误信息并发送
     // ... (发送错误信息的逻辑，请注意 sessionid 的来源) ...
 
     return nullptr; // ⬅️ 返回空指针表示失败
+    });
 }
 
 // 更新属性
 void PlayerDataManager::updatePlayerAttr(int uid, const std::string &field, int value)
 {
-    // 获取玩家锁
-    std::shared_ptr<std::mutex> player_mutex;
+    PlayerCache::Field f = PlayerCache::fieldOf(field);
+    if (f == PlayerCache::FIELD_COUNT)
     {
-        std::lock_guard<std::mutex> lock(mtx_map_);
-        // 查找uid对应的玩家锁
-        if (player_mutex_map_.find(uid) == player_mutex_map_.end())
-        {
-            // 没找到
-            player_mutex_map_.emplace(uid, std::make_shared<std::mutex>());
-        }
-        player_mutex = player_mutex_map_[uid];
+        std::cerr << "[UpdateAttr] 未知字段 " << field << std::endl;
+        return;
     }
-    // 加锁进行操作 保证同一个玩家的操作串行执行
-    std::lock_guard<std::mutex> lock(*player_mutex);
-    std::string redis_key = "player:" + std::to_string(uid);
-    // 检查redis中是否存在对应数据
-    if (!redis_->exists(redis_key))
+    // 在玩家邮箱上执行 保证同一个玩家的操作串行执行
+    actors_.call(uid, [&]
+                 {
+    // 只修改 L1 并标脏，由写回任务同步到 Redis 和 kafka
+    while (!cache_.update(uid, f, value))
     {
-        std::cout << "[RedisMiss] 玩家 " << uid << " 数据不存在，无法更新。" << std::endl;
-        return;
+        // 不在 L1 中，先加载（getPlayer 会放入 L1）
+        if (!getPlayer(uid))
+        {
+            std::cout << "[RedisMiss] 玩家 " << uid << " 数据不存在，无法更新。" << std::endl;
+            return;
+        }
     }
-    // 更新redis中玩家数据
+    std::cout << "[CacheUpdate] 玩家 " << uid
+              << " 字段 " << field
+              << " 更新为 " << value << std::endl; });
+}
+
+// 同步redis-》mysql
+bool PlayerDataManager::syncToMySQL(const std::vector<int> &uids)
+{
+    std::vector<msg::PlayerAttr> players;
+    std::vector<bool> found;
     try
     {
-        redis_->hset(redis_key, field, std::to_string(value));
-        std::cout << "[RedisUpdate] 玩家 " << uid
-                  << " 字段 " << field
-                  << " 更新为 " << value << std::endl;
+        found = readRecords(uids, players);
     }
     catch (const sw::redis::Error &err)
     {
-        std::cerr << "[RedisError] 更新玩家 " << uid
-                  << " 失败：" << err.what() << std::endl;
+        std::cerr << "[RedisError] 批量同步 MySQL 读取 Redis 失败：" << err.what() << std::endl;
+        return false;
+    }
+    std::vector<msg::PlayerAttr> rows;
+    rows.reserve(uids.size());
+    for (size_t i = 0; i < uids.size(); ++i)
+    {
+        // Redis 中已不存在的玩家（下线后过期）在下线时已经落盘
+        if (found[i])
+            rows.push_back(std::move(players[i]));
+    }
+    return UserDatamodel::instance().UpsertUserDataBatch(rows);
+}
+
+// 经验增加更新函数
+// 读改写由 Redis 中的 Lua 脚本原子完成（一次往返），多个服务器进程同时修改同一玩家也不会丢失更新。
+// 有异步客户端时不占用工作线程等待：邮箱在脚本执行期间保持占用，回复到达后在 io 线程上刷新 L1
+void PlayerDataManager::updateExepAndLevel(int uid, int addexep, std::function<void(const ExpResult &)> done)
+{
+    auto add_sync = [this, uid, addexep, done]
+    {
+        actors_.post(uid, [this, uid, addexep, done]
+                     { done(addExp(uid, addexep)); });
+    };
+    AsyncRedis *async_redis = async_redis_;
+    if (!async_redis)
+    {
+        add_sync();
         return;
     }
-    // 将数据变化信息写入kafka，用于异步同步mysql
+    actors_.post_async(uid, [this, uid, addexep, done, add_sync, async_redis](PlayerActors::Done release)
+                       {
+        try
+        {
+            // 先把 L1 中尚未写回的修改写入 Redis：同一连接按顺序执行，脚本基于写回后的值计算，不需要等待
+            PlayerCache::Dirty dirty;
+            if (cache_.takeDirty(uid, dirty))
+                writeBack(dirty, false);
+        }
+        catch (const std::exception &err)
+        {
+            std::cerr << "[RedisError] 玩家 " << uid << " 增加经验失败：" << err.what() << std::endl;
+            release();
+            done(ExpResult{});
+            return;
+        }
+        std::vector<std::string> args = {std::to_string(addexep)};
+        evalAsync(*async_redis, uid, PlayerScripts::ADD_EXP, redisKey(uid), args,
+                  [this, uid, done, add_sync, release](AsyncRedis::Reply reply)
+                  {
+            // 在 io 线程上执行，邮箱仍由本操作占有，期间该玩家的其他操作都在排队
+            ExpResult result;
+            bool missing = false;
+            if (!reply.ok())
+                std::cerr << "[RedisError] 玩家 " << uid << " 增加经验失败：" << reply.error() << std::endl;
+            else if (reply.elements.size() != 3)
+                missing = true;
+            else
+            {
+                result.ok = true;
+                result.level = static_cast<int>(reply.elements[0].integer);
+                result.exp = static_cast<int>(reply.elements[1].integer);
+                result.leveled_up = reply.elements[2].integer != 0;
+                cache_.refreshExpAndLevel(uid, result.exp, result.level);
+            }
+            release();
+            if (missing)
+            {
+                // Redis 中不存在：需要加载玩家（可能查 MySQL），在邮箱里走同步路径
+                add_sync();
+                return;
+            }
+            if (result.ok)
+            {
+                // kafka 推送在玩家邮箱里执行，不占用 io 线程；与之前写回的推送保持顺序
+                actors_.post(uid, [this, uid, result]
+                             { publishExp(uid, result); });
+            }
+            done(result); }); });
+}
+
+// 同步加经验（在玩家邮箱内调用）：Redis 中不存在时先加载玩家并写入 Redis
+PlayerDataManager::ExpResult PlayerDataManager::addExp(int uid, int addexep)
+{
+    ExpResult result;
     try
     {
-        /* code */
-        std::string msg = std::to_string(uid) + "|" + field + "|" + std::to_string(value); // 写入格式 uid|属性名|值
-        cppkafka::MessageBuilder builder(topic_);                                          // 用于构造消息的对象 builder
-        builder.payload(msg);                                                              // kafka消费者队列接收的消息
+        // 先把 L1 中尚未写回的修改写入 Redis，脚本基于 Redis 中的最新值计算
+        PlayerCache::Dirty dirty;
+        if (cache_.takeDirty(uid, dirty))
+            writeBack(dirty, true);
 
-        producer_->produce(builder); // 将消息放到生产者内部队列，异步将消息发送到kafka
-        producer_->flush();          // 保证及时送出消息
-        std::cout << "[Kafka] 推送玩家 " << uid << " 更新消息：" << msg << std::endl;
+        for (int attempt = 0; attempt < 2; ++attempt)
+        {
+            if (runAddExp(uid, addexep, result.level, result.exp, result.leveled_up))
+            {
+                // Redis 已是最新值，只刷新 L1 并推送 kafka
+                result.ok = true;
+                cache_.refreshExpAndLevel(uid, result.exp, result.level);
+                publishExp(uid, result);
+                return result;
+            }
+            // Redis 中不存在：加载玩家（L1 或 MySQL）并写入 Redis 后重试
+            auto player = getPlayer(uid);
+            if (!player)
+            {
+                std::cout << "[RedisMiss] 玩家 " << uid << " 数据不存在，无法增加经验。" << std::endl;
+                return result;
+            }
+            writeRecords({player.get()});
+        }
     }
-    catch (const cppkafka::Exception &ex)
+    catch (const std::exception &err)
     {
-        std::cerr << "[KafkaError] 推送玩家 " << uid << " 数据失败：" << ex.what() << std::endl;
+        std::cerr << "[RedisError] 玩家 " << uid << " 增加经验失败：" << err.what() << std::endl;
     }
+    return result;
 }
 
-// 同步redis-》mysql
-void PlayerDataManager::syncToMySQL(int uid, const std::string &field, int value)
+void PlayerDataManager::publishExp(int uid, const ExpResult &result)
+{
+    msg::PlayerAttr changed;
+    changed.set_uid(uid);
+    changed.set_level(result.level);
+    changed.set_exp(result.exp);
+    publishEvent(uid, (1u << PlayerCache::EXP) | (result.leveled_up ? 1u << PlayerCache::LEVEL : 0), changed);
+    std::cout << "[ExpUpdate] 玩家 " << uid
+              << " 当前经验：" << result.exp
+              << " 等级：" << result.level
+              << (result.leveled_up ? " (升级啦！)" : "") << std::endl;
+}
+
+bool PlayerDataManager::runAddExp(int uid, int addexep, int &level, int &exp, bool &leveled_up)
 {
-    // 在kafka消费队列消费时调用 同步mysql与redis中的数据
-    // 获取玩家锁
-    std::shared_ptr<std::mutex> playermutex;
+    std::vector<std::string> keys = {redisKey(uid)};
+    std::vector<std::string> args = {std::to_string(addexep)};
+    std::vector<long long> result;
+    if (AsyncRedis *async_redis = async_redis_)
     {
-        std::lock_guard<std::mutex> lock(mtx_map_);
-        if (player_mutex_map_.find(uid) == player_mutex_map_.end())
+        // 与该玩家的异步写回走同一个连接，保证脚本在之前的写回之后执行
+        AsyncRedis::Reply reply = evalAsync(*async_redis, uid, PlayerScripts::ADD_EXP, keys[0], args);
+        if (!reply.ok())
+            throw std::runtime_error(reply.error());
+        for (const AsyncRedis::Reply &element : reply.elements)
         {
-            // 没找到
-            player_mutex_map_[uid] = std::make_shared<std::mutex>();
+            result.push_back(element.integer);
         }
-        playermutex = player_mutex_map_[uid];
     }
-    std::lock_guard<std::mutex> lock(*playermutex);
+    else
+    {
+        runScript(PlayerScripts::ADD_EXP, [&](const std::string &script, bool by_sha)
+                  {
+            result.clear();
+            if (by_sha)
+                redis_->evalsha(script, keys.begin(), keys.end(), args.begin(), args.end(), std::back_inserter(result));
+            else
+                redis_->eval(script, keys.begin(), keys.end(), args.begin(), args.end(), std::back_inserter(result)); });
+    }
+    if (result.size() != 3)
+        return false;
+    level = static_cast<int>(result[0]);
+    exp = static_cast<int>(result[1]);
+    leveled_up = result[2] != 0;
+    return true;
+}
 
-    std::string redis_key = "player:" + std::to_string(uid);
-    try
+// 批量从redis中获取玩家数据
+void PlayerDataManager::batchLoadFromRedis(
+    const std::vector<int> &uids,
+    std::unordered_map<int, msg::PlayerAttr> &out)
+{
+    // 在线玩家直接从 L1 取，其余的一次 pipeline 全部读出
+    std::vector<int> missing;
+    for (int uid : uids)
     {
-        /* code */
-        if (!redis_->exists(redis_key))
+        msg::PlayerAttr cached;
+        if (cache_.get(uid, cached))
         {
-            std::cout << "[syncToMySQL] 玩家 " << uid << " Redis 数据不存在，跳过同步" << std::endl;
-            return;
+            out[uid] = cached;
+            continue;
+        }
+        if (known_uids_.mayExist(uid))
+            missing.push_back(uid);
+    }
+    if (missing.empty())
+        return;
+
+    uint64_t logouts = logout_seq_;
+    std::vector<msg::PlayerAttr> players;
+    std::vector<bool> found = readRecords(missing, players);
+    for (size_t i = 0; i < missing.size(); ++i)
+    {
+        if (!found[i])
+            continue; // Redis 中不存在，留给 MySQL 处理
+
+        int uid = missing[i];
+        // L1 中已有（读取期间被其他操作加载）时以 L1 为准
+        if (!cache_.get(uid, out[uid]))
+            out[uid] = players[i];
+        cacheLoaded(players[i], logouts);
+    }
+}
+
+// 把批量读到的记录放进 L1：在该玩家的邮箱里执行，与下线串行；
+// 读取之后有玩家下线过时不放入（读到的可能是下线写回之前的旧值），只是少一次缓存命中
+void PlayerDataManager::cacheLoaded(const msg::PlayerAttr &playerdata, uint64_t logouts)
+{
+    actors_.post(playerdata.uid(), [this, playerdata, logouts]
+                 {
+        // L1 中已有时 put 不会覆盖，以 L1 为准
+        if (logout_seq_ == logouts)
+            cache_.put(playerdata); });
+}
+
+// 批量从mysql中获取数据并且加入到redis中
+// 一次查询（where uid in）取回所有玩家，再用一个 pipeline 回填 Redis
+void PlayerDataManager::batchLoadFromMySQL(
+    const std::vector<int> &uids,
+    std::unordered_map<int, msg::PlayerAttr> &out)
+{
+    std::vector<int> missing;
+    for (int uid : uids)
+    {
+        msg::PlayerAttr cached;
+        if (cache_.get(uid, cached))
+        {
+            out[uid] = cached;
+            continue;
+        }
+        if (known_uids_.mayExist(uid))
+            missing.push_back(uid);
+    }
+    if (missing.empty())
+        return;
+
+    uint64_t logouts = logout_seq_;
+    std::vector<msg::PlayerAttr> players;
+    if (!UserDatamodel::instance().QueryUserDataBatch(missing, players))
+    {
+        std::cerr << "[MySQL] 批量查询 " << missing.size() << " 个玩家失败" << std::endl;
+        return;
+    }
+    std::unordered_set<int> found;
+    for (const msg::PlayerAttr &playerdata : players)
+    {
+        int uid = playerdata.uid();
+        found.insert(uid);
+        // L1 中已有（查询期间被其他操作加载）时以 L1 为准
+        if (!cache_.get(uid, out[uid]))
+            out[uid] = playerdata;
+        cacheLoaded(playerdata, logouts);
+    }
+    for (int uid : missing)
+    {
+        if (!found.count(uid))
+        {
+            std::cout << "玩家 uid=" << uid << " 不存在数据库" << std::endl;
+            known_uids_.markMissing(uid);
         }
+    }
 
-        // 获取 Redis 数据
-        std::unordered_map<std::string, std::string> data;
-        redis_->hgetall(redis_key, std::inserter(data, data.end()));
-
-        std::shared_ptr<msg::PlayerAttr> player = std::make_shared<msg::PlayerAttr>();
-        // 遍历map获取数据
-        player->set_uid(uid);
-        player->set_level(std::stoi(data["level"]));
-        player->set_exp(std::stoi(data["exp"]));
-        player->set_hp(std::stoi(data["hp"]));
-        player->set_mp(std::stoi(data["mp"]));
-        player->set_coin(std::stoi(data["coin"]));
-        player->set_x(std::stof(data["x"]));
-        player->set_y(std::stof(data["y"]));
-        player->set_z(std::stof(data["z"]));
-        // 在mysql更新
-        UserDatamodel::instance().UpdateUserData(*player);
+    // 回填 Redis：只写不存在的记录，查询期间其他路径写入的较新记录不会被覆盖
+    try
+    {
+        fillRecords(players, std::chrono::seconds(0), true);
     }
     catch (const sw::redis::Error &err)
     {
-        std::cerr << "[RedisError] 玩家 " << uid << " 同步 MySQL 读取 Redis 失败：" << err.what() << std::endl;
+        std::cerr << "[RedisError] 批量回填 " << players.size() << " 个玩家失败：" << err.what() << std::endl;
     }
 }
 
-// 经验增加更新函数
-void PlayerDataManager::updateExepAndLevel(int uid, int addexep, int &new_level, int &new_exp, bool &leveled_up)
+// 定时全量同步：在后台线程上启动一轮流式同步（runSyncAll）后立即返回，不占用工作线程；
+// 上一轮还在运行时不重复启动
+bool PlayerDataManager::syncAll()
 {
-    // 获取玩家锁
-    std::shared_ptr<std::mutex> player_mutex;
+    bool expected = false;
+    if (!sync_running_.compare_exchange_strong(expected, true))
+        return false;
+    // 上一轮的线程已经结束（running 是它最后修改的状态）
+    if (sync_thread_.joinable())
+        sync_thread_.join();
+    sync_thread_ = std::thread([this]
+                               {
+        runSyncAll();
+        sync_running_ = false; });
+    return true;
+}
+
+MySQLBatchWriter::Stats PlayerDataManager::mysqlWriterStats()
+{
+    return mysql_writer_->stats();
+}
+
+PlayerDataManager::SyncAllStats PlayerDataManager::syncAllStats() const
+{
+    SyncAllStats s;
+    s.running = sync_running_.load();
+    s.scanned_keys = sync_scanned_.load();
+    s.written_rows = sync_written_.load();
+    s.failed_rows = sync_failed_.load();
+    s.completed_runs = sync_runs_.load();
+    s.elapsed_ms = sync_elapsed_ms_.load();
+    return s;
+}
+
+// 流式全量同步：SCAN 分批取 key，批量读取（pipeline），多行 upsert 写入 MySQL，按行数限速
+void PlayerDataManager::runSyncAll()
+{
+    using namespace std::chrono;
+    const steady_clock::time_point started = steady_clock::now();
+    sync_scanned_ = 0;
+    sync_written_ = 0;
+    sync_failed_ = 0;
+    sync_elapsed_ms_ = 0;
+    std::cout << "[SyncAll] 开始全量同步" << std::endl;
+
+    auto report = [&]
+    {
+        long long ms = duration_cast<milliseconds>(steady_clock::now() - started).count();
+        sync_elapsed_ms_ = ms;
+        std::cout << "[SyncAll] 已扫描 " << sync_scanned_ << " 个 key，写入 " << sync_written_
+                  << " 行，失败 " << sync_failed_ << " 行，用时 " << ms << "ms，速率 "
+                  << (ms ? sync_written_ * 1000 / ms : 0) << " 行/秒" << std::endl;
+    };
+
+    long long cursor = 0;
+    size_t next_report = kSyncReportEvery;
+    bool complete = false;
+    while (!sync_stop_)
     {
-        std::lock_guard<std::mutex> lock(mtx_map_);
-        // 查找uid对应的玩家锁
-        if (player_mutex_map_.find(uid) == player_mutex_map_.end())
+        std::vector<std::string> keys;
+        try
         {
-            // 没找到
-            player_mutex_map_.emplace(uid, std::make_shared<std::mutex>());
+            cursor = redis_->scan(cursor, "player:*", kSyncScanCount, std::back_inserter(keys));
         }
-        player_mutex = player_mutex_map_[uid];
+        catch (const sw::redis::Error &err)
+        {
+            std::cerr << "[SyncAll] SCAN 失败，本轮中止：" << err.what() << std::endl;
+            break;
+        }
+        sync_scanned_ += keys.size();
+
+        std::vector<int> uids;
+        uids.reserve(keys.size());
+        for (const std::string &key : keys)
+        {
+            try
+            {
+                uids.push_back(std::stoi(key.substr(std::strlen("player:"))));
+            }
+            catch (const std::exception &)
+            {
+                // 不是玩家记录的 key
+            }
+        }
+
+        std::vector<msg::PlayerAttr> rows;
+        if (!uids.empty())
+        {
+            try
+            {
+                std::vector<msg::PlayerAttr> players;
+                std::vector<bool> found = readRecords(uids, players);
+                for (size_t i = 0; i < uids.size(); ++i)
+                {
+                    if (found[i])
+                        rows.push_back(std::move(players[i]));
+                }
+            }
+            catch (const sw::redis::Error &err)
+            {
+                std::cerr << "[SyncAll] 读取 Redis 失败：" << err.what() << std::endl;
+                sync_failed_ += uids.size();
+            }
+        }
+        if (!rows.empty())
+        {
+            if (UserDatamodel::instance().UpsertUserDataBatch(rows))
+                sync_written_ += rows.size();
+            else
+                sync_failed_ += rows.size();
+        }
+
+        if (sync_written_ + sync_failed_ >= next_report)
+        {
+            report();
+            next_report += kSyncReportEvery;
+        }
+        if (cursor == 0)
+        {
+            complete = true;
+            break;
+        }
+        // 限速：处理的总行数不超过 kSyncRowsPerSecond × 已用时间
+        auto deadline = started + microseconds((sync_written_ + sync_failed_) * 1000000 / kSyncRowsPerSecond);
+        std::unique_lock<std::mutex> lock(sync_mtx_);
+        sync_cv_.wait_until(lock, deadline, [this]
+                            { return sync_stop_.load(); });
     }
-    // 加锁进行操作 保证同一个玩家的操作串行执行
-    std::lock_guard<std::mutex> lock(*player_mutex);
-    // 查找redis，
-    std::string redis_key = "player:" + std::to_string(uid);
 
-    if (!redis_->exists(redis_key))
-    {
-        std::cout << "[RedisMiss] 玩家 " << uid << " 数据不存在，从MySQL加载..." << std::endl;
-        std::shared_ptr<msg::PlayerAttr> playerdata = std::make_shared<msg::PlayerAttr>();
-        playerdata->set_uid(uid);
-        // 不在缓存中，从数据库查询，并更新缓存；
-        if (UserDatamodel::instance().QueryUserData(*playerdata))
-        {
-            // 查询成功，更新缓存
-            // 将多个字段和值存入 std::map 中
-            std::unordered_map<std::string, std::string> player_data = {
-                {"level", std::to_string(playerdata->level())},
-                {"exp", std::to_string(playerdata->exp())},
-                {"hp", std::to_string(playerdata->hp())},
-                {"mp", std::to_string(playerdata->mp())},
-                {"coin", std::to_string(playerdata->coin())},
-                {"x", std::to_string(playerdata->x())},
-                {"y", std::to_string(playerdata->y())},
-                {"z", std::to_string(playerdata->z())}};
-            // 使用 hset 方法将多个字段及其值保存到 Redis
-            redis_->hset(redis_key, player_data.begin(), player_data.end());
-        }
-    }
-    // 读取当前经验与等级
-    auto exp_str = redis_->hget(redis_key, "exp");
-    auto level_str = redis_->hget(redis_key, "level");
-    int exp = exp_str ? std::stoi(*exp_str) : 0;
-    int level = level_str ? std::stoi(*level_str) : 1;
-
-    exp += addexep;
-    bool levelUp = false;
-    int nextLevelExp = 100 * level;
-    while (exp >= nextLevelExp)
-    {
-        exp -= nextLevelExp;
-        level++;
-        nextLevelExp = 100 * level;
-        levelUp = true;
-        leveled_up = true;
-    }
-    new_level = level;
-    new_exp = exp;
-    // Step 4: 更新Redis
-    std::unordered_map<std::string, std::string> updates = {
-        {"exp", std::to_string(exp)},
-        {"level", std::to_string(level)}};
-    redis_->hset(redis_key, updates.begin(), updates.end());
+    if (complete)
+        sync_runs_++;
+    report();
+    std::cout << "[SyncAll] 全量同步" << (complete ? "完成" : "中止") << std::endl;
+}
 
-    std::cout << "[ExpUpdate] 玩家 " << uid
-              << " 当前经验：" << exp
-              << " 等级：" << level
-              << (levelUp ? " (升级啦！)" : "") << std::endl;
+PlayerDataManager::RebuildStats PlayerDataManager::rebuildCache(const RebuildOptions &options)
+{
+    using namespace std::chrono;
+    const steady_clock::time_point started = steady_clock::now();
+    RebuildStats s{};
+    std::cout << "[Rebuild] 开始重建玩家缓存" << std::endl;
 
-    // Step 5: Kafka 异步同步 MySQL
-    try
+    // 1. 回放事件日志：每个玩家叠加后的字段值与位图，之后覆盖到快照上。
+    // 日志不保证按时间顺序（多个服务器进程、失败重试、溢写回放），每个字段只用更新的事件覆盖：
+    // 先比较 timestamp_ms，相同时比较 sequence
+    struct Overlay
     {
-        std::string msg = std::to_string(uid) + "|exp|" + std::to_string(exp);
-        producer_->produce(cppkafka::MessageBuilder(topic_).payload(msg));
+        uint32_t mask = 0;
+        msg::PlayerAttr attr;
+        int64_t timestamp_ms[PlayerCache::FIELD_COUNT] = {};
+        uint64_t sequence[PlayerCache::FIELD_COUNT] = {};
+    };
+    std::unordered_map<int, Overlay> overlay;
+    if (options.replay_log)
+    {
+        PlayerEventLog::Options log_opts;
+        log_opts.brokers = options.brokers;
+        log_opts.topic = options.topic;
+        PlayerEventLog::Stats log_stats{};
+        bool replayed = PlayerEventLog::replay(log_opts, [&](const msg::PlayerUpdateEvent &event)
+                                               {
+            Overlay &entry = overlay[event.uid()];
+            entry.attr.set_uid(event.uid());
+            uint32_t newer = 0;
+            for (int field = 0; field < PlayerCache::FIELD_COUNT; ++field)
+            {
+                uint32_t bit = 1u << field;
+                if (!(event.field_mask() & bit))
+                    continue;
+                if ((entry.mask & bit) &&
+                    std::make_pair(event.timestamp_ms(), event.sequence()) <=
+                        std::make_pair(entry.timestamp_ms[field], entry.sequence[field]))
+                    continue;
+                entry.timestamp_ms[field] = event.timestamp_ms();
+                entry.sequence[field] = event.sequence();
+                newer |= bit;
+            }
+            PlayerCache::copyFields(entry.attr, event.attr(), newer);
+            entry.mask |= newer; }, &log_stats);
+        s.log_events = log_stats.events;
+        s.log_players = overlay.size();
+        std::cout << "[Rebuild] 回放 " << log_stats.partitions << " 个分区的 " << log_stats.events << " 个事件，涉及 "
+                  << overlay.size() << " 个玩家" << (replayed ? "" : "（回放未完成，其余玩家以 MySQL 为准）") << std::endl;
+    }
 
-        if (levelUp)
+    // 2. 写 Redis 的线程：每页一个 pipeline
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<std::vector<msg::PlayerAttr>> pages;
+    bool done = false;
+    std::atomic<size_t> written = 0;
+    std::atomic<size_t> failed = 0;
+    size_t next_report = kRebuildReportEvery;
+    auto report = [&]
+    {
+        long long ms = duration_cast<milliseconds>(steady_clock::now() - started).count();
+        std::cout << "[Rebuild] 已写入 " << written << " 个玩家，失败 " << failed << "，用时 " << ms << "ms，速率 "
+                  << (ms ? written * 1000 / ms : 0) << " 玩家/秒" << std::endl;
+    };
+    std::vector<std::thread> writers;
+    for (size_t i = 0; i < std::max<size_t>(1, options.writers); ++i)
+    {
+        writers.emplace_back([&]
+                             {
+            while (true)
+            {
+                std::vector<msg::PlayerAttr> page;
+                {
+                    std::unique_lock<std::mutex> lock(mtx);
+                    cv.wait(lock, [&]
+                            { return !pages.empty() || done; });
+                    if (pages.empty())
+                        break;
+                    page = std::move(pages.front());
+                    pages.pop_front();
+                }
+                cv.notify_all();
+                try
+                {
+                    fillRecords(page, options.ttl, false);
+                    written += page.size();
+                }
+                catch (const sw::redis::Error &err)
+                {
+                    std::cerr << "[Rebuild] 写入 Redis 失败：" << err.what() << std::endl;
+                    failed += page.size();
+                }
+            } });
+    }
+    // 待写入的页数有上限，MySQL 读得比 Redis 写得快时等待
+    auto push = [&](std::vector<msg::PlayerAttr> page)
+    {
         {
-            std::string msg2 = std::to_string(uid) + "|level|" + std::to_string(level);
-            producer_->produce(cppkafka::MessageBuilder(topic_).payload(msg2));
+            std::unique_lock<std::mutex> lock(mtx);
+            cv.wait(lock, [&]
+                    { return pages.size() < kRebuildMaxPages; });
+            pages.push_back(std::move(page));
         }
+        cv.notify_all();
+        if (written + failed >= next_report)
+        {
+            report();
+            next_report += kRebuildReportEvery;
+        }
+    };
 
-        producer_->flush();
+    // 3. 按 uid 分页扫描 MySQL，叠加事件后交给写线程
+    bool snapshot_ok = true;
+    int after_uid = 0;
+    while (true)
+    {
+        std::vector<msg::PlayerAttr> page;
+        if (!UserDatamodel::instance().LoadUserDataRange(after_uid, options.page_size, page))
+        {
+            std::cerr << "[Rebuild] 读取 MySQL 失败，uid > " << after_uid << " 的玩家未重建" << std::endl;
+            snapshot_ok = false;
+            break;
+        }
+        if (page.empty())
+            break;
+        s.snapshot_rows += page.size();
+        after_uid = page.back().uid();
+        for (msg::PlayerAttr &player : page)
+        {
+            auto it = overlay.find(player.uid());
+            if (it == overlay.end())
+                continue;
+            PlayerCache::copyFields(player, it->second.attr, it->second.mask);
+            overlay.erase(it);
+        }
+        push(std::move(page));
     }
-    catch (const cppkafka::Exception &ex)
+    // MySQL 中还没有的玩家：只有事件覆盖了全部字段时才能得到完整记录
+    if (snapshot_ok)
     {
-        std::cerr << "[KafkaError] 玩家 " << uid << " 数据推送失败：" << ex.what() << std::endl;
+        const uint32_t all_fields = (1u << PlayerCache::FIELD_COUNT) - 1;
+        std::vector<msg::PlayerAttr> page;
+        for (auto &[uid, entry] : overlay)
+        {
+            if ((entry.mask & all_fields) != all_fields)
+                continue;
+            page.push_back(std::move(entry.attr));
+            if (page.size() >= static_cast<size_t>(options.page_size))
+            {
+                push(std::move(page));
+                page.clear();
+            }
+        }
+        if (!page.empty())
+            push(std::move(page));
     }
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        done = true;
+    }
+    cv.notify_all();
+    for (auto &writer : writers)
+    {
+        writer.join();
+    }
+
+    s.written = written;
+    s.failed = failed;
+    s.ok = snapshot_ok && s.failed == 0;
+    s.elapsed_ms = duration_cast<milliseconds>(steady_clock::now() - started).count();
+    s.players_per_sec = s.elapsed_ms ? s.written * 1000.0 / s.elapsed_ms : 0;
+    report();
+    std::cout << "[Rebuild] 重建" << (s.ok ? "完成" : "未完成") << "：MySQL " << s.snapshot_rows << " 个玩家，事件 "
+              << s.log_events << " 个，写入 " << s.written << " 个玩家，" << static_cast<long long>(s.players_per_sec)
+              << " 玩家/秒" << std::endl;
+    return s;
 }
 
-// 批量从redis中获取玩家数据
-void PlayerDataManager::batchLoadFromRedis(
-    const std::vector<int> &uids,
-    std::unordered_map<int, msg::PlayerAttr> &out)
+// 按当前存储格式以一个 pipeline 写入 Redis
+void PlayerDataManager::fillRecords(const std::vector<msg::PlayerAttr> &players, std::chrono::seconds ttl, bool if_absent)
 {
-    for (int uid : uids)
+    auto pipe = redis_->pipeline(false);
+    for (const msg::PlayerAttr &player : players)
     {
-        std::shared_ptr<std::mutex> player_mtx;
+        std::string key = redisKey(player.uid());
+        if (format_ == RedisFormat::HASH)
         {
-            std::lock_guard<std::mutex> lock(mtx_map_);
-            if (player_mutex_map_.find(uid) == player_mutex_map_.end())
-                player_mutex_map_.emplace(uid, std::make_shared<std::mutex>());
-            player_mtx = player_mutex_map_[uid];
+            RedisBatcher::Hash fields = PlayerRecord::toHash(player);
+            if (if_absent)
+            {
+                // 已存在的 hash 各字段都在，HSETNX 不会改动
+                for (const auto &[field, value] : fields)
+                {
+                    pipe.hsetnx(key, field, value);
+                }
+            }
+            else
+            {
+                pipe.del(key).hset(key, fields.begin(), fields.end());
+            }
+            if (ttl.count() > 0 && !if_absent)
+                pipe.expire(key, ttl);
         }
+        else
+        {
+            pipe.set(key, PlayerRecord::encode(player), ttl,
+                     if_absent ? sw::redis::UpdateType::NOT_EXIST : sw::redis::UpdateType::ALWAYS);
+        }
+    }
+    pipe.exec();
+}
 
-        std::lock_guard<std::mutex> lock(*player_mtx);
-        std::string redis_key = "player:" + std::to_string(uid);
+PlayerDataManager::~PlayerDataManager()
+{
+    sync_stop_ = true;
+    sync_cv_.notify_all();
+    if (sync_thread_.joinable())
+        sync_thread_.join();
+}
 
-        if (!redis_->exists(redis_key))
-            continue; // Redis 中不存在，留给 MySQL 处理
+// 玩家下线：把 L1 中未写回的修改写回 Redis 并移出 L1，把最终状态落到 MySQL，再给 Redis 记录设置过期时间，
+// Redis 内存只与在线（及最近下线）的玩家数有关，最终状态也不依赖 kafka 的投递
+void PlayerDataManager::playerLogout(int uid)
+{
+    // 落盘期间占有玩家邮箱（之后的登录加载排在它后面），但写回、读取和 MySQL 提交都不占用工作线程等待
+    actors_.post_async(uid, [this, uid](PlayerActors::Done release)
+                       {
+        auto player = std::make_shared<msg::PlayerAttr>();
+        bool cached = cache_.get(uid, *player);
+        PlayerCache::Dirty dirty;
+        if (!cache_.takeDirty(uid, dirty))
+        {
+            flushLogout(uid, player, cached, release);
+            return;
+        }
+        // 写回确认之后才移出 L1：失败时修改重新标脏留在 L1，由定期写回继续重试
+        writeBack(dirty, [this, uid, dirty, release](bool ok)
+                  {
+            if (!ok)
+            {
+                // Redis 中还是旧值，不读它也不设置过期时间，以内存中的状态落 MySQL
+                std::cerr << "[Logout] 玩家 " << uid << " 写回 Redis 失败，修改保留在内存中等待重试" << std::endl;
+                mysql_writer_->submit(dirty.attr, [uid, release](bool ok)
+                                      {
+                    if (!ok)
+                        std::cerr << "[Logout] 玩家 " << uid << " 写入 MySQL 失败" << std::endl;
+                    release(); });
+                return;
+            }
+            flushLogout(uid, std::make_shared<msg::PlayerAttr>(dirty.attr), true, release); }); });
+}
 
-        std::unordered_map<std::string, std::string> data;
-        redis_->hgetall(redis_key, std::inserter(data, data.end()));
+// 下线的后半段（写回已确认）：移出 L1，以 Redis 中的记录为准提交 MySQL，Redis 中没有时用 L1 中的副本
+void PlayerDataManager::flushLogout(int uid, std::shared_ptr<msg::PlayerAttr> player, bool cached,
+                                    PlayerActors::Done release)
+{
+    PlayerCache::Dirty late;
+    cache_.remove(uid, late); // 持有邮箱，写回期间不会有新的修改
+    ++logout_seq_; // 之前开始的批量加载不再把旧值放回 L1
 
-        msg::PlayerAttr playerdata;
-        playerdata.set_uid(uid);
-        playerdata.set_level(std::stoi(data["level"]));
-        playerdata.set_exp(std::stoi(data["exp"]));
-        playerdata.set_hp(std::stoi(data["hp"]));
-        playerdata.set_mp(std::stoi(data["mp"]));
-        playerdata.set_coin(std::stoi(data["coin"]));
-        playerdata.set_x(std::stof(data["x"]));
-        playerdata.set_y(std::stof(data["y"]));
-        playerdata.set_z(std::stof(data["z"]));
+    // 这批写入提交后（在写入线程上回调）再设置过期时间，保证 Redis 记录过期前 MySQL 已是最终状态
+    auto submit = [this, uid, release](const msg::PlayerAttr &final_state)
+    {
+        mysql_writer_->submit(final_state, [this, uid, release](bool ok)
+                              {
+            if (!ok)
+            {
+                // 不设置过期时间，留给 kafka 同步和定时全量同步
+                std::cerr << "[Logout] 玩家 " << uid << " 写入 MySQL 失败，保留 Redis 数据" << std::endl;
+                release();
+                return;
+            }
+            expireAfterLogout(uid, release); });
+    };
+    auto nothing = [uid, release]
+    {
+        std::cout << "[Logout] 玩家 " << uid << " 没有需要落盘的数据" << std::endl;
+        release();
+    };
 
-        out[uid] = playerdata;
+    // 以 Redis 为准（经验等级由脚本在 Redis 中修改，其他进程也可能改过）
+    if (AsyncRedis *async_redis = async_redis_)
+    {
+        readRecordAsync(*async_redis, uid, [uid, player, cached, release, submit, nothing](ReadResult result, const msg::PlayerAttr &record)
+                        {
+            if (result == ReadResult::FOUND)
+                submit(record);
+            else if (result == ReadResult::FAILED)
+            {
+                std::cerr << "[RedisError] 玩家 " << uid << " 下线落盘失败：读取 Redis 失败" << std::endl;
+                release();
+            }
+            else if (cached)
+                submit(*player);
+            else
+                nothing(); });
+        return;
+    }
+    try
+    {
+        if (!readRecord(uid, *player) && !cached)
+        {
+            nothing();
+            return;
+        }
+    }
+    catch (const sw::redis::Error &err)
+    {
+        std::cerr << "[RedisError] 玩家 " << uid << " 下线落盘失败：" << err.what() << std::endl;
+        release();
+        return;
     }
+    submit(*player);
 }
 
-// 批量从mysql中获取数据并且加入到redis中
-void PlayerDataManager::batchLoadFromMySQL(
-    const std::vector<int> &uids,
-    std::unordered_map<int, msg::PlayerAttr> &out)
+// 下线落盘后设置 Redis 记录的过期时间，完成后释放玩家邮箱（在写入线程上调用）
+void PlayerDataManager::expireAfterLogout(int uid, PlayerActors::Done release)
 {
-    for (int uid : uids)
+    auto logged_out = [uid]
+    {
+        std::cout << "[Logout] 玩家 " << uid << " 下线，已写入 MySQL 并释放内存缓存" << std::endl;
+    };
+    if (AsyncRedis *async_redis = async_redis_)
     {
-        std::shared_ptr<std::mutex> player_mtx;
+        // 不阻塞写入线程，与该玩家之前的写回走同一个连接
+        std::vector<std::string> argv = {"EXPIRE", redisKey(uid), std::to_string(kLogoutTtl.count())};
+        async_redis->command(uid, std::move(argv), [uid, release, logged_out](AsyncRedis::Reply reply)
+                             {
+            if (reply.ok())
+                logged_out();
+            else
+                std::cerr << "[RedisError] 玩家 " << uid << " 设置过期时间失败：" << reply.error() << std::endl;
+            release(); });
+        return;
+    }
+    try
+    {
+        redis_->expire(redisKey(uid), kLogoutTtl);
+        logged_out();
+    }
+    catch (const sw::redis::Error &err)
+    {
+        std::cerr << "[RedisError] 玩家 " << uid << " 设置过期时间失败：" << err.what() << std::endl;
+    }
+    release();
+}
+
+// 定期写回：每个脏玩家在自己的邮箱里写回，与该玩家的其他操作串行
+void PlayerDataManager::flushDirtyPlayers()
+{
+    for (int uid : cache_.dirtyUids())
+    {
+        actors_.post(uid, [this, uid]
+                     {
+            PlayerCache::Dirty dirty;
+            if (cache_.takeDirty(uid, dirty))
+            {
+                writeBack(dirty, false);
+            } });
+    }
+}
+
+// 把一个玩家的修改写回 Redis，确认后把变化的字段推送到 kafka 用于异步同步 mysql
+// 写回脚本只改写脏字段，不会覆盖其他服务器进程对该玩家其他字段的修改
+// 启用异步客户端时不阻塞工作线程，确认后在 io 线程上回调；同一玩家的写入走同一个连接，不会乱序
+void PlayerDataManager::writeBack(const PlayerCache::Dirty &dirty, std::function<void(bool)> done)
+{
+    int uid = dirty.uid;
+    std::string key = redisKey(uid);
+    PlayerScripts::Id script = PlayerScripts::WRITE_HASH;
+    std::vector<std::string> args = {std::to_string(dirty.mask)};
+    if (format_ == RedisFormat::HASH)
+    {
+        for (int i = 0; i < PlayerCache::FIELD_COUNT; ++i)
+        {
+            args.push_back(PlayerCache::fieldValue(dirty.attr, static_cast<PlayerCache::Field>(i)));
+        }
+    }
+    else
+    {
+        script = PlayerScripts::WRITE_BINARY;
+        args.push_back(PlayerRecord::encode(dirty.attr));
+    }
+
+    AsyncRedis *async_redis = async_redis_;
+    if (!async_redis)
+    {
+        try
+        {
+            std::vector<std::string> keys = {key};
+            runScript(script, [&](const std::string &source, bool by_sha)
+                      {
+                if (by_sha)
+                    redis_->evalsha<long long>(source, keys.begin(), keys.end(), args.begin(), args.end());
+                else
+                    redis_->eval<long long>(source, keys.begin(), keys.end(), args.begin(), args.end()); });
+        }
+        catch (const sw::redis::Error &err)
         {
-            std::lock_guard<std::mutex> lock(mtx_map_);
-            if (player_mutex_map_.find(uid) == player_mutex_map_.end())
-                player_mutex_map_.emplace(uid, std::make_shared<std::mutex>());
-            player_mtx = player_mutex_map_[uid];
+            std::cerr << "[RedisError] 写回玩家 " << uid << " 失败：" << err.what() << std::endl;
+            // 仍在 L1 中则重新标脏，下个周期重试
+            cache_.writeDone(uid, dirty.mask);
+            done(false);
+            return;
+        }
+        cache_.writeDone(uid, 0);
+        publishDirty(dirty);
+        done(true);
+        return;
+    }
+
+    // 脚本未缓存（Redis 重启后）时 evalAsync 在同一连接上退回 EVAL，不会让写回失败
+    evalAsync(*async_redis, uid, script, key, args, [this, dirty, done](AsyncRedis::Reply reply)
+              {
+        if (!reply.ok())
+        {
+            std::cerr << "[RedisError] 写回玩家 " << dirty.uid << " 失败：" << reply.error() << std::endl;
+            // 仍在 L1 中则重新标脏，下个周期重试（在这里重发可能与之后的写回乱序）
+            cache_.writeDone(dirty.uid, dirty.mask);
         }
+        else
+        {
+            cache_.writeDone(dirty.uid, 0);
+            // kafka 推送在玩家邮箱里执行，不占用 io 线程
+            actors_.post(dirty.uid, [this, dirty]
+                         { publishDirty(dirty); });
+        }
+        done(reply.ok()); });
+}
+
+// 阻塞版本：wait 为 true 时等待确认（同步路径上回调已就地执行，不会等待）
+bool PlayerDataManager::writeBack(const PlayerCache::Dirty &dirty, bool wait)
+{
+    auto acked = std::make_shared<std::promise<bool>>();
+    std::future<bool> acked_future = acked->get_future();
+    writeBack(dirty, [acked](bool ok)
+              { acked->set_value(ok); });
+    return !wait || acked_future.get();
+}
 
-        std::lock_guard<std::mutex> lock(*player_mtx);
+// 推送一个玩家所有变化的字段（一个事件）
+void PlayerDataManager::publishDirty(const PlayerCache::Dirty &dirty)
+{
+    publishEvent(dirty.uid, dirty.mask, dirty.attr);
+}
+
+// 将数据变化事件写入kafka，用于异步同步mysql
+void PlayerDataManager::publishEvent(int uid, uint32_t mask, const msg::PlayerAttr &attr)
+{
+    msg::PlayerUpdateEvent event;
+    event.set_version(kEventVersion);
+    event.set_uid(uid);
+    event.set_sequence(++event_seq_);
+    event.set_timestamp_ms(std::chrono::duration_cast<std::chrono::milliseconds>(
+                               std::chrono::system_clock::now().time_since_epoch())
+                               .count());
+    event.set_field_mask(mask);
+    *event.mutable_attr() = attr;
+    std::string payload;
+    event.SerializeToString(&payload);
+    // uid 作为 key：同一玩家的事件进入同一分区，消费顺序与产生顺序一致
+    // 只放入发送队列，不等待 broker 确认；投递失败由 KafkaPublisher 重投并计数
+    if (publisher_->publish(std::to_string(uid), payload))
+        std::cout << "[Kafka] 推送玩家 " << uid << " 更新事件 seq=" << event.sequence() << " mask=" << mask << std::endl;
+    else
+        std::cerr << "[KafkaError] 推送玩家 " << uid << " 数据失败 seq=" << event.sequence() << std::endl;
+}
 
-        msg::PlayerAttr playerdata;
-        playerdata.set_uid(uid);
+bool PlayerDataManager::readRecord(int uid, msg::PlayerAttr &out)
+{
+    std::vector<msg::PlayerAttr> players;
+    if (!readRecords({uid}, players)[0])
+        return false;
+    out = players[0];
+    return true;
+}
 
-        // 查询数据库
-        if (!UserDatamodel::instance().QueryUserData(playerdata))
+// 从 Redis 批量读取玩家记录，返回值第 i 位表示 uids[i] 是否存在
+std::vector<bool> PlayerDataManager::readRecords(const std::vector<int> &uids, std::vector<msg::PlayerAttr> &out)
+{
+    RedisFormat format = format_;
+    std::vector<std::string> keys;
+    keys.reserve(uids.size());
+    for (int uid : uids)
+    {
+        keys.push_back(redisKey(uid));
+    }
+    out.assign(uids.size(), msg::PlayerAttr());
+    for (size_t i = 0; i < uids.size(); ++i)
+    {
+        out[i].set_uid(uids[i]);
+    }
+    std::vector<bool> found(uids.size(), false);
+
+    // 需要按 hash 格式读取的下标
+    std::vector<size_t> hash_index;
+    if (format == RedisFormat::HASH)
+    {
+        for (size_t i = 0; i < uids.size(); ++i)
         {
-            std::cout << "玩家 uid=" << uid << " 不存在数据库" << std::endl;
-            continue;
+            hash_index.push_back(i);
+        }
+    }
+    else
+    {
+        std::vector<RedisBatcher::GetResult> results = batcher_->getMany(keys);
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            if (results[i].wrong_type)
+            {
+                // 迁移模式下尚未改写的旧 hash，在下一次写回时变为二进制
+                if (format == RedisFormat::MIGRATE)
+                    hash_index.push_back(i);
+                continue;
+            }
+            if (results[i].value && !PlayerRecord::decode(*results[i].value, out[i]))
+            {
+                std::cerr << "[RedisError] 玩家 " << uids[i] << " 记录格式错误，长度 " << results[i].value->size() << std::endl;
+                continue;
+            }
+            found[i] = results[i].value.has_value();
         }
+    }
+    if (hash_index.empty())
+        return found;
 
-        // 写回 Redis
-        std::string redis_key = "player:" + std::to_string(uid);
-        std::unordered_map<std::string, std::string> redis_data = {
-            {"level", std::to_string(playerdata.level())},
-            {"exp", std::to_string(playerdata.exp())},
-            {"hp", std::to_string(playerdata.hp())},
-            {"mp", std::to_string(playerdata.mp())},
-            {"coin", std::to_string(playerdata.coin())},
-            {"x", std::to_string(playerdata.x())},
-            {"y", std::to_string(playerdata.y())},
-            {"z", std::to_string(playerdata.z())}};
-        redis_->hset(redis_key, redis_data.begin(), redis_data.end());
+    std::vector<std::string> hash_keys;
+    for (size_t i : hash_index)
+    {
+        hash_keys.push_back(keys[i]);
+    }
+    std::vector<RedisBatcher::Hash> hashes = batcher_->hgetallMany(hash_keys);
+    for (size_t j = 0; j < hash_index.size(); ++j)
+    {
+        size_t i = hash_index[j];
+        found[i] = !hashes[j].empty() && PlayerRecord::fromHash(hashes[j], out[i]);
+    }
+    return found;
+}
 
-        out[uid] = playerdata;
+// 把玩家记录整条写入 Redis（一个 pipeline）
+void PlayerDataManager::writeRecords(const std::vector<const msg::PlayerAttr *> &players)
+{
+    if (format_ == RedisFormat::HASH)
+    {
+        std::vector<std::pair<std::string, RedisBatcher::Hash>> items;
+        items.reserve(players.size());
+        for (const msg::PlayerAttr *player : players)
+        {
+            items.emplace_back(redisKey(player->uid()), PlayerRecord::toHash(*player));
+        }
+        batcher_->hsetMany(items);
+        return;
     }
-}
\ No newline at end of file
+    // SET 会覆盖旧的 hash，迁移模式下写一次即完成该玩家的迁移
+    std::vector<std::pair<std::string, std::string>> items;
+    items.reserve(players.size());
+    for (const msg::PlayerAttr *player : players)
+    {
+        items.emplace_back(redisKey(player->uid()), PlayerRecord::encode(*player));
+    }
+    batcher_->setMany(items);
+}
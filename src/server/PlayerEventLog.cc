@@ -0,0 +1,101 @@
+#include "PlayerEventLog.h"
+
+#include <cppkafka/cppkafka.h>
+
+#include <iostream>
+#include <map>
+
+bool PlayerEventLog::replay(const Options &options, const Handler &handler, Stats *stats)
+{
+    Stats s{};
+    try
+    {
+        cppkafka::Configuration config = {
+            {"metadata.broker.list", options.brokers},
+            {"group.id", "player_event_replay"}, // 只用 assign，不加入消费组
+            {"enable.auto.commit", false}};
+        cppkafka::Consumer consumer(config);
+
+        // 记下每个分区当前的高水位作为回放终点
+        std::map<int, long long> end;
+        cppkafka::TopicPartitionList partitions;
+        cppkafka::TopicMetadata metadata = consumer.get_metadata(consumer.get_topic(options.topic));
+        for (const cppkafka::PartitionMetadata &partition : metadata.get_partitions())
+        {
+            int id = static_cast<int>(partition.get_id());
+            auto [low, high] = consumer.query_offsets(cppkafka::TopicPartition(options.topic, id));
+            if (high <= low)
+                continue;
+            end[id] = high;
+            partitions.emplace_back(options.topic, id, cppkafka::TopicPartition::OFFSET_BEGINNING);
+        }
+        s.partitions = end.size();
+        if (!partitions.empty())
+            consumer.assign(partitions);
+
+        auto last_message = std::chrono::steady_clock::now();
+        while (!end.empty())
+        {
+            std::vector<cppkafka::Message> messages = consumer.poll_batch(options.poll_batch, std::chrono::milliseconds(100));
+            if (messages.empty())
+            {
+                // compact 之后 offset 不连续，按消费位置判断是否已经读完
+                cppkafka::TopicPartitionList remaining;
+                for (const auto &[id, offset] : end)
+                {
+                    remaining.emplace_back(options.topic, id);
+                }
+                for (const cppkafka::TopicPartition &tp : consumer.get_offsets_position(remaining))
+                {
+                    auto it = end.find(tp.get_partition());
+                    if (it != end.end() && tp.get_offset() >= it->second)
+                        end.erase(it);
+                }
+                if (!end.empty() && std::chrono::steady_clock::now() - last_message > options.timeout)
+                {
+                    std::cerr << "[EventLog] 读取超时，还有 " << end.size() << " 个分区未读完" << std::endl;
+                    if (stats)
+                        *stats = s;
+                    return false;
+                }
+                continue;
+            }
+            last_message = std::chrono::steady_clock::now();
+            for (const cppkafka::Message &msg : messages)
+            {
+                if (msg.get_error())
+                {
+                    if (!msg.is_eof())
+                        std::cerr << "[KafkaError] " << msg.get_error() << std::endl;
+                    continue;
+                }
+                auto it = end.find(msg.get_partition());
+                if (it == end.end() || msg.get_offset() >= it->second)
+                    continue; // 开始回放之后产生的事件
+                const cppkafka::Buffer &payload = msg.get_payload();
+                msg::PlayerUpdateEvent event;
+                if (event.ParseFromArray(payload.get_data(), static_cast<int>(payload.get_size())))
+                {
+                    handler(event);
+                    s.events++;
+                }
+                else
+                {
+                    s.invalid++;
+                }
+                if (msg.get_offset() + 1 >= it->second)
+                    end.erase(it);
+            }
+        }
+    }
+    catch (const cppkafka::Exception &ex)
+    {
+        std::cerr << "[EventLog] 回放失败：" << ex.what() << std::endl;
+        if (stats)
+            *stats = s;
+        return false;
+    }
+    if (stats)
+        *stats = s;
+    return true;
+}
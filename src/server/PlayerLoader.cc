@@ -0,0 +1,25 @@
+#include "PlayerLoader.h"
+
+PlayerLoader::PlayerLoader(PlayerActors &actors, PlayerCache &cache) : actors_(actors), cache_(cache)
+{
+}
+
+PlayerLoader::Player PlayerLoader::loadOnce(int uid, const std::function<Player()> &load)
+{
+    // 在玩家邮箱上执行，排队期间可能已被其他操作加载
+    auto load_in_mailbox = [&]() -> Player
+    {
+        msg::PlayerAttr cached;
+        if (cache_.get(uid, cached))
+            return std::make_shared<msg::PlayerAttr>(cached);
+        return load();
+    };
+    // 已在该玩家邮箱内（操作内部嵌套调用）：直接加载，否则等待别人的加载会与邮箱互相等待
+    if (PlayerActors::is_draining(uid))
+        return load_in_mailbox();
+
+    Player shared = loads_.run(uid, [&]
+                               { return actors_.call(uid, load_in_mailbox); });
+    // 每个调用方拿到独立的副本
+    return shared ? std::make_shared<msg::PlayerAttr>(*shared) : nullptr;
+}
@@ -0,0 +1,89 @@
+#include "PlayerRecord.h"
+
+#include <bit>
+#include <cstring>
+#include <cstdint>
+
+static_assert(std::endian::native == std::endian::little, "二进制记录按小端布局，直接 memcpy");
+
+namespace
+{
+    template <typename T>
+    void put(std::string &buf, PlayerCache::Field field, T value)
+    {
+        static_assert(sizeof(T) == 4);
+        std::memcpy(&buf[PlayerRecord::fieldOffset(field)], &value, sizeof(T));
+    }
+
+    template <typename T>
+    T take(const std::string &buf, PlayerCache::Field field)
+    {
+        T value;
+        std::memcpy(&value, &buf[PlayerRecord::fieldOffset(field)], sizeof(T));
+        return value;
+    }
+}
+
+std::string PlayerRecord::encode(const msg::PlayerAttr &attr)
+{
+    std::string buf(kBinarySize, '\0');
+    buf[0] = kVersion;
+    put<int32_t>(buf, PlayerCache::LEVEL, attr.level());
+    put<int32_t>(buf, PlayerCache::EXP, attr.exp());
+    put<int32_t>(buf, PlayerCache::HP, attr.hp());
+    put<int32_t>(buf, PlayerCache::MP, attr.mp());
+    put<int32_t>(buf, PlayerCache::COIN, attr.coin());
+    put<float>(buf, PlayerCache::X, attr.x());
+    put<float>(buf, PlayerCache::Y, attr.y());
+    put<float>(buf, PlayerCache::Z, attr.z());
+    return buf;
+}
+
+bool PlayerRecord::decode(const std::string &data, msg::PlayerAttr &out)
+{
+    if (data.size() != kBinarySize || data[0] != kVersion)
+        return false;
+    out.set_level(take<int32_t>(data, PlayerCache::LEVEL));
+    out.set_exp(take<int32_t>(data, PlayerCache::EXP));
+    out.set_hp(take<int32_t>(data, PlayerCache::HP));
+    out.set_mp(take<int32_t>(data, PlayerCache::MP));
+    out.set_coin(take<int32_t>(data, PlayerCache::COIN));
+    out.set_x(take<float>(data, PlayerCache::X));
+    out.set_y(take<float>(data, PlayerCache::Y));
+    out.set_z(take<float>(data, PlayerCache::Z));
+    return true;
+}
+
+std::unordered_map<std::string, std::string> PlayerRecord::toHash(const msg::PlayerAttr &attr)
+{
+    std::unordered_map<std::string, std::string> data;
+    for (int i = 0; i < PlayerCache::FIELD_COUNT; ++i)
+    {
+        auto field = static_cast<PlayerCache::Field>(i);
+        data.emplace(PlayerCache::fieldName(field), PlayerCache::fieldValue(attr, field));
+    }
+    return data;
+}
+
+bool PlayerRecord::fromHash(const std::unordered_map<std::string, std::string> &data, msg::PlayerAttr &out)
+{
+    auto value = [&](PlayerCache::Field field) -> const std::string *
+    {
+        auto it = data.find(PlayerCache::fieldName(field));
+        return it == data.end() ? nullptr : &it->second;
+    };
+    for (int i = 0; i < PlayerCache::FIELD_COUNT; ++i)
+    {
+        if (!value(static_cast<PlayerCache::Field>(i)))
+            return false;
+    }
+    out.set_level(std::stoi(*value(PlayerCache::LEVEL)));
+    out.set_exp(std::stoi(*value(PlayerCache::EXP)));
+    out.set_hp(std::stoi(*value(PlayerCache::HP)));
+    out.set_mp(std::stoi(*value(PlayerCache::MP)));
+    out.set_coin(std::stoi(*value(PlayerCache::COIN)));
+    out.set_x(std::stof(*value(PlayerCache::X)));
+    out.set_y(std::stof(*value(PlayerCache::Y)));
+    out.set_z(std::stof(*value(PlayerCache::Z)));
+    return true;
+}
@@ -0,0 +1,94 @@
+#include "PlayerScripts.h"
+
+namespace
+{
+    // 经验等级公式与原 C++ 实现一致：升到下一级需要 100 * level 经验
+    const char *const kAddExp = R"lua(
+local key = KEYS[1]
+local add = tonumber(ARGV[1])
+local kind = redis.call('TYPE', key).ok
+local level, exp
+if kind == 'string' then
+    local record = redis.call('GET', key)
+    if #record ~= 33 then
+        return redis.error_reply('ERR bad player record')
+    end
+    local _
+    _, level, exp = struct.unpack('<Bii', record)
+elseif kind == 'hash' then
+    local values = redis.call('HMGET', key, 'level', 'exp')
+    level = tonumber(values[1])
+    exp = tonumber(values[2])
+    if not level or not exp then
+        return redis.error_reply('ERR bad player record')
+    end
+else
+    return {}
+end
+
+exp = exp + add
+local up = 0
+while exp >= 100 * level do
+    exp = exp - 100 * level
+    level = level + 1
+    up = 1
+end
+
+if kind == 'string' then
+    redis.call('SETRANGE', key, 1, struct.pack('<ii', level, exp))
+else
+    redis.call('HSET', key, 'level', level, 'exp', exp)
+end
+redis.call('PERSIST', key)
+return {level, exp, up}
+)lua";
+
+    const char *const kWriteBinary = R"lua(
+local key = KEYS[1]
+local mask = tonumber(ARGV[1])
+local record = ARGV[2]
+if redis.call('TYPE', key).ok ~= 'string' or redis.call('STRLEN', key) ~= #record then
+    redis.call('SET', key, record)
+    return 1
+end
+for i = 0, 7 do
+    if bit.band(mask, bit.lshift(1, i)) ~= 0 then
+        redis.call('SETRANGE', key, 1 + 4 * i, string.sub(record, 2 + 4 * i, 5 + 4 * i))
+    end
+end
+redis.call('PERSIST', key)
+return 1
+)lua";
+
+    const char *const kWriteHash = R"lua(
+local key = KEYS[1]
+local mask = tonumber(ARGV[1])
+local names = {'level', 'exp', 'hp', 'mp', 'coin', 'x', 'y', 'z'}
+local full = redis.call('TYPE', key).ok ~= 'hash'
+if full then
+    redis.call('DEL', key)
+end
+for i = 1, 8 do
+    if full or bit.band(mask, bit.lshift(1, i - 1)) ~= 0 then
+        redis.call('HSET', key, names[i], ARGV[i + 1])
+    end
+end
+redis.call('PERSIST', key)
+return 1
+)lua";
+}
+
+const char *PlayerScripts::source(Id id)
+{
+    switch (id)
+    {
+    case ADD_EXP:
+        return kAddExp;
+    case WRITE_BINARY:
+        return kWriteBinary;
+    case WRITE_HASH:
+        return kWriteHash;
+    default:
+        return "";
+    }
+}
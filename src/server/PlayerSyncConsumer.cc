@@ -0,0 +1,371 @@
+#include "PlayerSyncConsumer.h"
+#include "protocol.pb.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+    // 同步线程没有新消息时的检查间隔（按窗口写出）
+    const std::chrono::milliseconds kWorkerIdle(50);
+    // 同步线程积压过多时拉取线程的等待间隔
+    const std::chrono::milliseconds kBackoff(10);
+}
+
+PlayerSyncConsumer::PlayerSyncConsumer(Options options, SyncFunc sync)
+    : options_(std::move(options)), sync_(std::move(sync))
+{
+    cppkafka::Configuration config = {
+        {"metadata.broker.list", options_.brokers},
+        {"group.id", options_.group_id},
+        {"enable.auto.commit", false},    // 写入 MySQL 之后再手动提交 offset
+        {"auto.offset.reset", "earliest"} // 没有提交过 offset 的分区从头开始消费
+    };
+    // 异步提交的结果在拉取线程 poll 时回调，失败的分区在下次提交时重试
+    config.set_offset_commit_callback([this](cppkafka::Consumer &, cppkafka::Error error, const cppkafka::TopicPartitionList &offsets)
+                                      {
+        if (error)
+        {
+            std::cerr << "[KafkaConsumer] 提交 offset 失败：" << error.to_string() << std::endl;
+            return;
+        }
+        std::lock_guard<std::mutex> lock(commit_mtx_);
+        for (const cppkafka::TopicPartition &tp : offsets)
+        {
+            long long &committed = committed_[tp.get_partition()];
+            committed = std::max(committed, static_cast<long long>(tp.get_offset()));
+        } });
+    consumer_ = std::make_unique<cppkafka::Consumer>(config);
+
+    // 分区回收前（rebalance 或退出）：写完已拉取的消息并同步提交，新的消费者从这里继续
+    consumer_->set_revocation_callback([this](const cppkafka::TopicPartitionList &partitions)
+                                       {
+        drain_all();
+        commit(true);
+        std::lock_guard<std::mutex> lock(commit_mtx_);
+        for (const cppkafka::TopicPartition &tp : partitions)
+        {
+            assigned_.erase(tp.get_partition());
+            to_commit_.erase(tp.get_partition());
+            committed_.erase(tp.get_partition());
+            high_.erase(tp.get_partition());
+        }
+        std::cout << "[KafkaConsumer] 回收 " << partitions.size() << " 个分区" << std::endl; });
+    consumer_->set_assignment_callback([this](const cppkafka::TopicPartitionList &partitions)
+                                       {
+        // 已提交的 offset 作为堆积量的起点（没有提交过时为负数，按低水位计算）
+        cppkafka::TopicPartitionList committed;
+        try
+        {
+            committed = consumer_->get_offsets_committed(partitions);
+        }
+        catch (const cppkafka::Exception &ex)
+        {
+            std::cerr << "[KafkaConsumer] 查询已提交 offset 失败：" << ex.what() << std::endl;
+        }
+        std::lock_guard<std::mutex> lock(commit_mtx_);
+        for (const cppkafka::TopicPartition &tp : partitions)
+        {
+            assigned_.insert(tp.get_partition());
+        }
+        for (const cppkafka::TopicPartition &tp : committed)
+        {
+            committed_[tp.get_partition()] = tp.get_offset();
+        }
+        std::cout << "[KafkaConsumer] 分配到 " << partitions.size() << " 个分区" << std::endl; });
+
+    for (size_t i = 0; i < std::max<size_t>(1, options_.workers); ++i)
+    {
+        auto worker = std::make_unique<Worker>();
+        worker->coalescer = std::make_unique<SyncCoalescer>(sync_, options_.window, options_.max_uids);
+        workers_.push_back(std::move(worker));
+    }
+    for (auto &worker : workers_)
+    {
+        Worker *w = worker.get();
+        w->thread = std::thread([this, w]
+                                { worker_loop(*w); });
+    }
+}
+
+PlayerSyncConsumer::~PlayerSyncConsumer()
+{
+    // 先关闭消费者：关闭时会触发回收回调，需要同步线程还在
+    try
+    {
+        consumer_.reset();
+    }
+    catch (const cppkafka::Exception &ex)
+    {
+        std::cerr << "[KafkaConsumer] 关闭消费者失败：" << ex.what() << std::endl;
+    }
+    quit_ = true;
+    for (auto &worker : workers_)
+    {
+        {
+            std::lock_guard<std::mutex> lock(worker->mtx);
+        }
+        worker->cv.notify_all();
+        if (worker->thread.joinable())
+            worker->thread.join();
+    }
+}
+
+void PlayerSyncConsumer::stop()
+{
+    stop_ = true;
+}
+
+void PlayerSyncConsumer::run()
+{
+    consumer_->subscribe({options_.topic});
+    std::cout << "[KafkaConsumer] Started listening on topic: " << options_.topic
+              << "，同步线程 " << workers_.size() << " 个" << std::endl;
+
+    auto last_report = std::chrono::steady_clock::now();
+    while (!stop_)
+    {
+        // 提交同步线程已经写出的 offset
+        commit(false);
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_report >= options_.lag_report)
+        {
+            last_report = now;
+            report_lag();
+        }
+
+        // 同步线程跟不上时暂停拉取，避免消息在内存里无限堆积
+        bool backlog = false;
+        for (auto &worker : workers_)
+        {
+            std::lock_guard<std::mutex> lock(worker->mtx);
+            backlog = backlog || worker->queue.size() >= options_.max_queued;
+        }
+        if (backlog)
+        {
+            std::this_thread::sleep_for(kBackoff);
+            continue;
+        }
+
+        // 超时返回，空闲时也能提交与上报
+        std::vector<cppkafka::Message> messages = consumer_->poll_batch(options_.poll_batch, std::chrono::milliseconds(100));
+        for (cppkafka::Message &msg : messages)
+        {
+            if (msg.get_error())
+            {
+                if (!msg.is_eof())
+                    std::cerr << "[KafkaError] " << msg.get_error() << std::endl;
+                continue;
+            }
+            // 按分区分发：消息 key 为 uid，同一玩家的消息在同一分区，由同一个同步线程按顺序处理，
+            // 一个分区的 offset 也只由一个同步线程推进
+            Worker &worker = *workers_[static_cast<size_t>(msg.get_partition()) % workers_.size()];
+            {
+                std::lock_guard<std::mutex> lock(worker.mtx);
+                worker.queue.push_back(std::move(msg));
+            }
+            worker.cv.notify_one();
+        }
+    }
+
+    // 退出：写完已拉取的消息，同步提交后离开消费组（触发回收回调）
+    drain_all();
+    commit(true);
+    try
+    {
+        consumer_->unsubscribe();
+    }
+    catch (const cppkafka::Exception &ex)
+    {
+        std::cerr << "[KafkaConsumer] 退出消费组失败：" << ex.what() << std::endl;
+    }
+    report_lag();
+}
+
+void PlayerSyncConsumer::worker_loop(Worker &worker)
+{
+    while (true)
+    {
+        std::deque<cppkafka::Message> batch;
+        size_t drain = 0;
+        {
+            std::unique_lock<std::mutex> lock(worker.mtx);
+            worker.cv.wait_for(lock, kWorkerIdle, [&]
+                               { return !worker.queue.empty() || worker.drain_requested != worker.drain_done || quit_; });
+            if (quit_ && worker.queue.empty())
+                break;
+            batch.swap(worker.queue);
+            // 在取走消息的同时记下请求，保证请求之前分发的消息都在这一批里
+            drain = worker.drain_requested;
+        }
+
+        for (const cppkafka::Message &msg : batch)
+        {
+            const cppkafka::Buffer &payload = msg.get_payload();
+            msg::PlayerUpdateEvent event;
+            if (event.ParseFromArray(payload.get_data(), static_cast<int>(payload.get_size())))
+            {
+                // 只记录玩家变了，写出时从 Redis 读取最新的完整状态
+                worker.coalescer->add(event.uid());
+            }
+            else
+            {
+                // 格式错误的消息跳过，offset 照常推进
+                std::cerr << "[KafkaConsumer] Invalid message format, partition " << msg.get_partition()
+                          << " offset " << msg.get_offset() << std::endl;
+            }
+            long long &pending = worker.pending[msg.get_partition()];
+            pending = std::max(pending, static_cast<long long>(msg.get_offset()));
+        }
+
+        bool draining = drain != worker.drain_done;
+        bool ok = draining ? worker.coalescer->flush() : worker.coalescer->maybeFlush();
+        // 合并器里没有未写出的玩家时，这些分区到目前为止的消息都已写入 MySQL
+        if (ok && worker.coalescer->pending() == 0 && !worker.pending.empty())
+        {
+            ready_to_commit(worker.pending);
+            worker.pending.clear();
+        }
+        if (draining)
+        {
+            // 写出失败也结束本次等待：offset 不提交，由接手分区的消费者重新消费
+            {
+                std::lock_guard<std::mutex> lock(worker.mtx);
+                worker.drain_done = drain;
+            }
+            worker.cv.notify_all();
+        }
+    }
+}
+
+void PlayerSyncConsumer::ready_to_commit(const std::map<int, long long> &offsets)
+{
+    std::lock_guard<std::mutex> lock(commit_mtx_);
+    for (const auto &[partition, offset] : offsets)
+    {
+        // 提交的是下一条待消费的位置
+        long long &next = to_commit_[partition];
+        next = std::max(next, offset + 1);
+    }
+}
+
+void PlayerSyncConsumer::commit(bool sync)
+{
+    cppkafka::TopicPartitionList offsets;
+    {
+        std::lock_guard<std::mutex> lock(commit_mtx_);
+        for (const auto &[partition, offset] : to_commit_)
+        {
+            // 已回收的分区不再提交；已提交过的位置不重复提交
+            if (!assigned_.count(partition))
+                continue;
+            auto it = committed_.find(partition);
+            if (it != committed_.end() && it->second >= offset)
+                continue;
+            offsets.emplace_back(options_.topic, partition, offset);
+        }
+    }
+    if (offsets.empty())
+        return;
+    try
+    {
+        if (!sync)
+        {
+            // 结果在 offset 提交回调里处理
+            consumer_->async_commit(offsets);
+            return;
+        }
+        consumer_->commit(offsets);
+        std::lock_guard<std::mutex> lock(commit_mtx_);
+        for (const cppkafka::TopicPartition &tp : offsets)
+        {
+            long long &committed = committed_[tp.get_partition()];
+            committed = std::max(committed, static_cast<long long>(tp.get_offset()));
+        }
+    }
+    catch (const cppkafka::Exception &ex)
+    {
+        std::cerr << "[KafkaConsumer] 提交 offset 失败：" << ex.what() << std::endl;
+    }
+}
+
+void PlayerSyncConsumer::drain_all()
+{
+    std::vector<size_t> targets;
+    for (auto &worker : workers_)
+    {
+        {
+            std::lock_guard<std::mutex> lock(worker->mtx);
+            targets.push_back(++worker->drain_requested);
+        }
+        worker->cv.notify_all();
+    }
+    for (size_t i = 0; i < workers_.size(); ++i)
+    {
+        Worker &worker = *workers_[i];
+        std::unique_lock<std::mutex> lock(worker.mtx);
+        worker.cv.wait(lock, [&]
+                       { return worker.drain_done >= targets[i]; });
+    }
+}
+
+void PlayerSyncConsumer::report_lag()
+{
+    std::set<int> partitions;
+    {
+        std::lock_guard<std::mutex> lock(commit_mtx_);
+        partitions = assigned_;
+    }
+    // 高水位取 librdkafka 拉取时缓存的值，不额外请求 broker
+    std::map<int, std::pair<long long, long long>> watermarks;
+    for (int partition : partitions)
+    {
+        try
+        {
+            auto offsets = consumer_->get_offsets(cppkafka::TopicPartition(options_.topic, partition));
+            watermarks[partition] = {std::get<0>(offsets), std::get<1>(offsets)};
+        }
+        catch (const cppkafka::Exception &ex)
+        {
+            std::cerr << "[KafkaConsumer] 查询分区 " << partition << " 高水位失败：" << ex.what() << std::endl;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(commit_mtx_);
+        for (const auto &[partition, offsets] : watermarks)
+        {
+            high_[partition] = offsets.second;
+            // 没有提交过 offset 时从低水位算起
+            auto it = committed_.find(partition);
+            if (it == committed_.end() || it->second < 0)
+                committed_[partition] = offsets.first;
+        }
+    }
+
+    long long total = 0;
+    std::vector<PartitionLag> lags = lag();
+    for (const PartitionLag &l : lags)
+    {
+        total += l.lag;
+    }
+    std::cout << "[KafkaConsumer] 同步堆积 " << total << " 条";
+    for (const PartitionLag &l : lags)
+    {
+        std::cout << "，分区 " << l.partition << ": " << l.lag;
+    }
+    std::cout << std::endl;
+}
+
+std::vector<PlayerSyncConsumer::PartitionLag> PlayerSyncConsumer::lag() const
+{
+    std::lock_guard<std::mutex> lock(commit_mtx_);
+    std::vector<PartitionLag> lags;
+    for (const auto &[partition, high] : high_)
+    {
+        auto it = committed_.find(partition);
+        long long committed = it == committed_.end() ? 0 : it->second;
+        lags.push_back({partition, high, committed, std::max(0LL, high - committed)});
+    }
+    return lags;
+}
@@ -0,0 +1,211 @@
+#include "RedisBatcher.h"
+
+#include <iterator>
+
+RedisBatcher::RedisBatcher(std::shared_ptr<sw::redis::Redis> redis, size_t max_batch, size_t max_leaders)
+    : redis_(std::move(redis)), max_batch_(max_batch), max_leaders_(max_leaders)
+{
+}
+
+RedisBatcher::Hash RedisBatcher::hgetall(const std::string &key)
+{
+    Hash result;
+    Op op{Op::HGETALL, &key};
+    op.hash = &result;
+    submit({op});
+    return result;
+}
+
+std::vector<RedisBatcher::Hash> RedisBatcher::hgetallMany(const std::vector<std::string> &keys)
+{
+    std::vector<Hash> results(keys.size());
+    if (keys.empty())
+        return results;
+    std::vector<Op> ops;
+    ops.reserve(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        Op op{Op::HGETALL, &keys[i]};
+        op.hash = &results[i];
+        ops.push_back(op);
+    }
+    submit(std::move(ops));
+    return results;
+}
+
+void RedisBatcher::hset(const std::string &key, const Hash &fields)
+{
+    Op op{Op::HSET, &key};
+    op.fields = &fields;
+    submit({op});
+}
+
+void RedisBatcher::hsetMany(const std::vector<std::pair<std::string, Hash>> &items)
+{
+    if (items.empty())
+        return;
+    std::vector<Op> ops;
+    ops.reserve(items.size());
+    for (const auto &[key, fields] : items)
+    {
+        Op op{Op::HSET, &key};
+        op.fields = &fields;
+        ops.push_back(op);
+    }
+    submit(std::move(ops));
+}
+
+std::vector<RedisBatcher::GetResult> RedisBatcher::getMany(const std::vector<std::string> &keys)
+{
+    std::vector<GetResult> results(keys.size());
+    if (keys.empty())
+        return results;
+    std::vector<Op> ops;
+    ops.reserve(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        Op op{Op::GET, &keys[i]};
+        op.get = &results[i];
+        ops.push_back(op);
+    }
+    submit(std::move(ops));
+    return results;
+}
+
+void RedisBatcher::setMany(const std::vector<std::pair<std::string, std::string>> &items)
+{
+    if (items.empty())
+        return;
+    std::vector<Op> ops;
+    ops.reserve(items.size());
+    for (const auto &[key, value] : items)
+    {
+        Op op{Op::SET, &key};
+        op.value = &value;
+        ops.push_back(op);
+    }
+    submit(std::move(ops));
+}
+
+void RedisBatcher::submit(std::vector<Op> ops)
+{
+    Request request;
+    request.ops = std::move(ops);
+    std::future<void> done = request.done.get_future();
+
+    std::unique_lock<std::mutex> lock(mtx_);
+    pending_.push_back(&request);
+    if (leaders_ < max_leaders_)
+    {
+        // 成为 leader：把队列中所有请求（包括执行期间新到的）都执行完再退出
+        leaders_++;
+        while (!pending_.empty())
+        {
+            std::vector<Request *> batch;
+            size_t commands = 0;
+            size_t taken = 0;
+            for (; taken < pending_.size() && (batch.empty() || commands + pending_[taken]->ops.size() <= max_batch_); ++taken)
+            {
+                batch.push_back(pending_[taken]);
+                commands += pending_[taken]->ops.size();
+            }
+            pending_.erase(pending_.begin(), pending_.begin() + taken);
+            lock.unlock();
+            flush(batch);
+            lock.lock();
+        }
+        leaders_--;
+    }
+    lock.unlock();
+    // 其它线程做 leader 时在这里等待，出错时把异常抛给调用方
+    done.get();
+}
+
+void RedisBatcher::flush(std::vector<Request *> &batch)
+{
+    std::optional<sw::redis::QueuedReplies> replies;
+    size_t commands = 0;
+    try
+    {
+        // 使用连接池中的连接，不为每次 flush 新建连接
+        auto pipe = redis_->pipeline(false);
+        for (Request *request : batch)
+        {
+            for (const Op &op : request->ops)
+            {
+                switch (op.kind)
+                {
+                case Op::HGETALL:
+                    pipe.hgetall(*op.key);
+                    break;
+                case Op::HSET:
+                    pipe.hset(*op.key, op.fields->begin(), op.fields->end());
+                    break;
+                case Op::GET:
+                    pipe.get(*op.key);
+                    break;
+                case Op::SET:
+                    pipe.set(*op.key, *op.value);
+                    break;
+                }
+                ++commands;
+            }
+        }
+        replies.emplace(pipe.exec());
+    }
+    catch (...)
+    {
+        // 连接或发送失败：这批命令都没有结果
+        for (Request *request : batch)
+        {
+            request->done.set_exception(std::current_exception());
+        }
+        return;
+    }
+    flushes_++;
+    commands_ += commands;
+
+    // 逐个请求检查回复：某条命令出错只让它所属的请求失败，同一 pipeline 中的其他请求不受影响
+    size_t idx = 0;
+    for (Request *request : batch)
+    {
+        size_t end = idx + request->ops.size();
+        try
+        {
+            for (const Op &op : request->ops)
+            {
+                switch (op.kind)
+                {
+                case Op::HGETALL:
+                    replies->get(idx, std::inserter(*op.hash, op.hash->end()));
+                    break;
+                case Op::HSET:
+                    replies->get<long long>(idx);
+                    break;
+                case Op::GET:
+                    try
+                    {
+                        op.get->value = replies->get<sw::redis::OptionalString>(idx);
+                    }
+                    catch (const sw::redis::ReplyError &)
+                    {
+                        // WRONGTYPE：key 存的不是字符串，由调用方按其它格式处理
+                        op.get->wrong_type = true;
+                    }
+                    break;
+                case Op::SET:
+                    replies->get<std::string>(idx);
+                    break;
+                }
+                ++idx;
+            }
+        }
+        catch (...)
+        {
+            idx = end;
+            request->done.set_exception(std::current_exception());
+            continue;
+        }
+        request->done.set_value();
+    }
+}
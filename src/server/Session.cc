@@ -2,6 +2,7 @@
 #include "protocol.pb.h"
 #include "MessageDispatcher.h"
 #include "SessionManager.h"
+#include "PlayerDataManager.h"
 
 #include <memory>
 
@@ -219,13 +220,19 @@ void Session::close()
   boost::system::error_code ec;
   socket_.close(ec);
 
-  auto uid_copy = uid_;
+  int uid_copy = uid_.exchange(-1); // 保证下线只处理一次
+  // 尚未执行的登录预取直接取消
+  if (uid_copy != -1)
+    PlayerDataManager::getInstance().cancelPrefetch(uid_copy);
   auto id_copy = id_;
   // ✅ 直接使用成员 worker_pool_ 来投递任务
   worker_pool_.enqueue([uid_copy, id_copy]()
                        { 
         SessionManager::getinstance().RemoveUser(uid_copy);
-        SessionManager::getinstance().del(id_copy); });
+        SessionManager::getinstance().del(id_copy);
+        // 已登录的玩家：写回内存中的修改并释放缓存
+        if (uid_copy != -1)
+            PlayerDataManager::getInstance().playerLogout(uid_copy); });
 
   std::cout << "[Server DEBUG] Session closed." << std::endl;
 }
\ No newline at end of file
@@ -0,0 +1,252 @@
+#include "SpillLog.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace
+{
+    // 缓冲区超过这个大小时立即写盘，不等 sync_interval
+    const size_t kWriteThreshold = 1 << 20;
+    // 记录头：crc32、key 长度、payload 长度
+    const size_t kHeaderSize = 12;
+
+    uint32_t crc32(const char *data, size_t size, uint32_t crc = 0)
+    {
+        static const auto table = []
+        {
+            std::vector<uint32_t> t(256);
+            for (uint32_t i = 0; i < 256; ++i)
+            {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k)
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                t[i] = c;
+            }
+            return t;
+        }();
+        crc = ~crc;
+        for (size_t i = 0; i < size; ++i)
+            crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    void put_u32(std::string &out, uint32_t value)
+    {
+        char bytes[4];
+        std::memcpy(bytes, &value, 4);
+        out.append(bytes, 4);
+    }
+
+    uint32_t get_u32(const char *data)
+    {
+        uint32_t value;
+        std::memcpy(&value, data, 4);
+        return value;
+    }
+
+    bool write_all(int fd, const char *data, size_t size)
+    {
+        while (size > 0)
+        {
+            ssize_t n = ::write(fd, data, size);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            data += n;
+            size -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+}
+
+SpillLog::SpillLog(Options options) : options_(std::move(options))
+{
+    std::filesystem::create_directories(options_.dir);
+    // 上次运行留下的段全部待回放
+    for (const auto &entry : std::filesystem::directory_iterator(options_.dir))
+    {
+        unsigned long long id = 0;
+        std::string name = entry.path().filename().string();
+        if (std::sscanf(name.c_str(), "seg-%llu.log", &id) != 1)
+            continue;
+        sealed_.push_back(id);
+        pending_bytes_ += entry.file_size();
+    }
+    std::sort(sealed_.begin(), sealed_.end());
+    active_id_ = sealed_.empty() ? 1 : sealed_.back() + 1;
+    if (!sealed_.empty())
+        std::cout << "[SpillLog] 发现 " << sealed_.size() << " 个待回放的段，共 " << pending_bytes_ << " 字节" << std::endl;
+    writer_ = std::thread([this]
+                          { writer_loop(); });
+}
+
+SpillLog::~SpillLog()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    writer_.join();
+    std::lock_guard<std::mutex> lock(file_mtx_);
+    if (active_fd_ >= 0)
+        ::close(active_fd_);
+}
+
+bool SpillLog::append(const std::string &key, const std::string &payload)
+{
+    size_t size = kHeaderSize + key.size() + payload.size();
+    if (pending_bytes_ + size > options_.max_bytes)
+        return false;
+    uint32_t crc = crc32(payload.data(), payload.size(), crc32(key.data(), key.size()));
+    bool wake;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        put_u32(buffer_, crc);
+        put_u32(buffer_, static_cast<uint32_t>(key.size()));
+        put_u32(buffer_, static_cast<uint32_t>(payload.size()));
+        buffer_.append(key);
+        buffer_.append(payload);
+        buffer_records_++;
+        wake = buffer_.size() >= kWriteThreshold;
+    }
+    pending_bytes_ += size;
+    if (wake)
+        cv_.notify_one();
+    return true;
+}
+
+void SpillLog::writer_loop()
+{
+    while (true)
+    {
+        bool stopping;
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            cv_.wait_for(lock, options_.sync_interval, [this]
+                         { return stop_ || buffer_.size() >= kWriteThreshold; });
+            stopping = stop_;
+        }
+        // 先持有 file_mtx_ 再取缓冲区（与 oldestSegment 相同的顺序）：取出的记录一定在之后取出的记录之前写盘
+        std::string buffer;
+        size_t records = 0;
+        std::lock_guard<std::mutex> file_lock(file_mtx_);
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            buffer.swap(buffer_);
+            std::swap(records, buffer_records_);
+        }
+        if (!buffer.empty())
+            write_buffer(buffer, records);
+        if (stopping)
+            break;
+    }
+}
+
+void SpillLog::write_buffer(std::string &buffer, size_t records)
+{
+    if (active_fd_ < 0)
+    {
+        active_fd_ = ::open(segment_path(active_id_).c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        active_size_ = 0;
+    }
+    if (active_fd_ < 0 || !write_all(active_fd_, buffer.data(), buffer.size()) || ::fdatasync(active_fd_) != 0)
+    {
+        std::cerr << "[SpillLog] 写入 " << segment_path(active_id_) << " 失败：" << std::strerror(errno)
+                  << "，丢失 " << records << " 条记录" << std::endl;
+        lost_ += records;
+        pending_bytes_ -= buffer.size();
+        return;
+    }
+    active_size_ += buffer.size();
+    if (active_size_ >= options_.segment_bytes)
+        seal_active();
+}
+
+void SpillLog::seal_active()
+{
+    if (active_fd_ < 0)
+        return;
+    ::close(active_fd_);
+    active_fd_ = -1;
+    sealed_.push_back(active_id_++);
+}
+
+bool SpillLog::oldestSegment(uint64_t &id, std::vector<Record> &records)
+{
+    records.clear();
+    // 先把缓冲区写盘，再封存当前段；持有 file_mtx_ 之后才取缓冲区，
+    // 写入线程已取出的更早的记录此时已经写盘，不会排到这批之后
+    std::lock_guard<std::mutex> lock(file_mtx_);
+    std::string buffer;
+    size_t count = 0;
+    {
+        std::lock_guard<std::mutex> buffer_lock(mtx_);
+        buffer.swap(buffer_);
+        std::swap(count, buffer_records_);
+    }
+    if (!buffer.empty())
+        write_buffer(buffer, count);
+    if (sealed_.empty())
+        seal_active();
+    if (sealed_.empty())
+        return false;
+
+    id = sealed_.front();
+    std::ifstream in(segment_path(id), std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    size_t pos = 0;
+    while (pos + kHeaderSize <= data.size())
+    {
+        uint32_t crc = get_u32(data.data() + pos);
+        size_t key_size = get_u32(data.data() + pos + 4);
+        size_t payload_size = get_u32(data.data() + pos + 8);
+        size_t end = pos + kHeaderSize + key_size + payload_size;
+        if (end > data.size())
+            break;
+        const char *key = data.data() + pos + kHeaderSize;
+        const char *payload = key + key_size;
+        if (crc32(payload, payload_size, crc32(key, key_size)) != crc)
+            break;
+        records.push_back({std::string(key, key_size), std::string(payload, payload_size)});
+        pos = end;
+    }
+    if (pos != data.size())
+        std::cerr << "[SpillLog] 段 " << id << " 末尾有 " << data.size() - pos << " 字节不完整的记录，已丢弃" << std::endl;
+    return true;
+}
+
+void SpillLog::removeSegment(uint64_t id)
+{
+    std::lock_guard<std::mutex> lock(file_mtx_);
+    auto it = std::find(sealed_.begin(), sealed_.end(), id);
+    if (it == sealed_.end())
+        return;
+    sealed_.erase(it);
+    std::error_code ec;
+    std::string path = segment_path(id);
+    size_t size = std::filesystem::file_size(path, ec);
+    if (!ec)
+        pending_bytes_ -= std::min<size_t>(size, pending_bytes_);
+    if (!std::filesystem::remove(path, ec) && ec)
+        std::cerr << "[SpillLog] 删除 " << path << " 失败：" << ec.message() << std::endl;
+}
+
+std::string SpillLog::segment_path(uint64_t id) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "seg-%020llu.log", static_cast<unsigned long long>(id));
+    return options_.dir + "/" + name;
+}
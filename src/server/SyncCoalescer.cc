@@ -0,0 +1,41 @@
+#include "SyncCoalescer.h"
+
+SyncCoalescer::SyncCoalescer(Flush flush, std::chrono::milliseconds window, size_t max_uids)
+    : flush_(std::move(flush)), window_(window), max_uids_(max_uids)
+{
+}
+
+void SyncCoalescer::add(int uid)
+{
+    if (dirty_.empty())
+        window_start_ = Clock::now();
+    dirty_.insert(uid);
+    stats_.messages++;
+}
+
+bool SyncCoalescer::maybeFlush()
+{
+    if (dirty_.empty())
+        return true;
+    if (dirty_.size() < max_uids_ && Clock::now() - window_start_ < window_)
+        return true;
+    return flush();
+}
+
+bool SyncCoalescer::flush()
+{
+    if (dirty_.empty())
+        return true;
+    std::vector<int> uids(dirty_.begin(), dirty_.end());
+    if (!flush_(uids))
+    {
+        // 保留这批玩家，下一个窗口重试
+        stats_.failed_flushes++;
+        window_start_ = Clock::now();
+        return false;
+    }
+    stats_.written_uids += uids.size();
+    stats_.flushes++;
+    dirty_.clear();
+    return true;
+}
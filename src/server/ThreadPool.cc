@@ -1,9 +1,60 @@
 #include "ThreadPool.h"
 
 #include <iostream>
+#include <algorithm>
+#include <csignal>
+#include <execinfo.h>
+#include <pthread.h>
+#include <unistd.h>
 
-ThreadPool::ThreadPool(size_t num_threads) : num_threads_(num_threads)
+namespace
 {
+    // 当前 steady_clock 时间（纳秒）
+    long long now_ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    // 看门狗向卡死线程发送 SIGUSR2，由该线程自己把调用栈打印到 stderr
+    void dump_stack_handler(int)
+    {
+        void *frames[64];
+        int n = backtrace(frames, 64);
+        backtrace_symbols_fd(frames, n, STDERR_FILENO);
+    }
+
+    void install_stack_dumper()
+    {
+        static std::once_flag once;
+        std::call_once(once, []
+                       {
+            // 先调用一次 backtrace，让 libgcc 在信号处理函数之外完成加载
+            void *warmup[1];
+            backtrace(warmup, 1);
+
+            struct sigaction sa = {};
+            sa.sa_handler = dump_stack_handler;
+            sigemptyset(&sa.sa_mask);
+            sa.sa_flags = SA_RESTART;
+            sigaction(SIGUSR2, &sa, nullptr); });
+    }
+}
+
+ThreadPool::ThreadPool(size_t num_threads)
+    : ThreadPool(ElasticOptions{std::max<size_t>(num_threads, 1), std::max<size_t>(num_threads, 1)})
+{
+}
+
+ThreadPool::ThreadPool(const ElasticOptions &options) : options_(options)
+{
+    if (options_.min_threads == 0)
+        options_.min_threads = 1;
+    if (options_.max_threads < options_.min_threads)
+        options_.max_threads = options_.min_threads;
+    // 按最大线程数预留槽位，扩缩容时只启停线程，不改动这些数组
+    num_threads_ = options_.max_threads;
     stop_ = false;
     // 根据线程数初始化分片资源
     // 1. 初始化分片队列、互斥锁和条件变量
@@ -17,20 +68,66 @@ ThreadPool::ThreadPool(size_t num_threads) : num_threads_(num_threads)
 
         // conditions_ (std::condition_variable) - 必须使用 emplace_back
         conditions_.push_back(std::make_unique<std::condition_variable>());
+
+        // worker_states_ 看门狗读取的线程运行状态
+        worker_states_.push_back(std::make_unique<WorkerState>());
+
+        // 线程槽位，扩容时才真正创建线程
+        workers_.emplace_back();
     }
 
-    for (size_t i = 0; i < num_threads_; ++i)
+    // 2. 初始化虚拟分片，初始映射到最小线程数
+    size_t num_vshards = std::max<size_t>(256, num_threads_ * 16);
+    for (size_t v = 0; v < num_vshards; ++v)
+    {
+        vshards_.push_back(std::make_unique<VirtualShard>());
+        vshards_[v]->owner = v % options_.min_threads;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(scale_mutex_);
+        for (size_t i = 0; i < options_.min_threads; ++i)
+        {
+            // 创建并启动线程。将线程与特定的队列索引 i 绑定。
+            start_worker(i);
+        }
+        active_threads_ = options_.min_threads;
+    }
+
+    // 定时线程推进时间轮
+    timer_thread_ = std::thread(&ThreadPool::timer_loop, this);
+
+    if (options_.min_threads < options_.max_threads)
     {
-        // 创建并启动线程。将线程与特定的队列索引 i 绑定。
-        workers_.emplace_back(&ThreadPool::worker_loop, this, i); // 就地构造一个thread 传入回调函数以及相关参数
+        // 弹性模式需要监控线程采样队列积压
+        monitor_thread_ = std::thread(&ThreadPool::monitor_loop, this);
+        std::cout << "ThreadPool initialized with " << options_.min_threads << "-" << options_.max_threads
+                  << " worker threads (Affinity Mode, elastic)." << std::endl;
+    }
+    else
+    {
+        std::cout << "ThreadPool initialized with " << num_threads_ << " worker threads (Affinity Mode)." << std::endl;
     }
-    std::cout << "ThreadPool initialized with " << num_threads_ << " worker threads (Affinity Mode)." << std::endl;
 }
 // 析构函数
 ThreadPool::~ThreadPool()
 {
     stop_ = true;
 
+    // 停止监控线程和定时线程（先于工作线程，避免退出过程中再触发扩容或投递）
+    {
+        std::lock_guard<std::mutex> lock(monitor_mutex_);
+        monitor_cond_.notify_all();
+    }
+    if (monitor_thread_.joinable())
+    {
+        monitor_thread_.join();
+    }
+    if (timer_thread_.joinable())
+    {
+        timer_thread_.join();
+    }
+
     // 唤起所有变量
     for (auto &cond : conditions_)
     {
@@ -46,6 +143,92 @@ ThreadPool::~ThreadPool()
         }
     }
 }
+
+void ThreadPool::push_keyed(long long key, std::function<void()> func, int msgid)
+{
+    size_t v = std::hash<long long>{}(key) % vshards_.size();
+    VirtualShard &shard = *vshards_[v];
+    // 2. 构造任务
+    AffinityTask affinity_task = {key, std::move(func), msgid, static_cast<int>(v)};
+
+    // 持有分片锁直到入队完成，保证同一分片的任务按投递顺序进入队列
+    std::lock_guard<std::mutex> shard_lock(shard.mtx);
+    bool force_remap = false;
+    for (;;)
+    {
+        size_t active = active_threads_.load();
+        // 分片没有未完成任务时才迁移到当前映射的线程，否则沿用原线程以保证顺序
+        if (force_remap || shard.pending.load() == 0)
+        {
+            shard.owner = v % active;
+        }
+        size_t index = shard.owner;
+        // 开启了卡死改道时，绕开正在卡死的分片
+        if (reroute_on_stall_ && worker_states_[index]->stalled.load())
+        {
+            index = route_around_stall(v % active);
+            shard.owner = index;
+        }
+
+        {
+            // 获取对应队列锁
+            std::unique_lock<std::mutex> lock(*queue_mutexes_[index]);
+
+            if (stop_)
+            {
+                throw std::runtime_error("Attempted to enqueue task on a stopped ThreadPool.");
+            }
+            if (!worker_states_[index]->running)
+            {
+                // 目标线程已退役退出，说明该分片已无积压任务，重新映射即可
+                force_remap = true;
+                continue;
+            }
+            shard.pending++;
+            sharded_queues_[index].push(std::move(affinity_task));
+        }
+
+        conditions_[index]->notify_one();
+        return;
+    }
+}
+
+void ThreadPool::push_general(std::function<void()> func)
+{
+    // 构造一个 AffinityTask，Key 可以设置为 0 或其他无效值
+    AffinityTask general_task = {0, std::move(func)};
+    for (;;)
+    {
+        // 1. 使用轮询策略选择一个活跃队列索引
+        size_t index = next_queue_index_++ % active_threads_.load();
+        if (reroute_on_stall_)
+        {
+            index = route_around_stall(index);
+        }
+
+        {
+            // 获取对应队列锁
+            std::unique_lock<std::mutex> lock(*queue_mutexes_[index]);
+
+            if (stop_)
+            {
+                throw std::runtime_error("Attempted to enqueue task on a stopped ThreadPool.");
+            }
+            if (!worker_states_[index]->running)
+            {
+                continue; // 缩容刚刚退出的线程，换一个
+            }
+
+            // 投递到选定的分片队列
+            sharded_queues_[index].push(std::move(general_task));
+        }
+
+        // 通知等待的线程
+        conditions_[index]->notify_one();
+        return;
+    }
+}
+
 void ThreadPool::worker_loop(size_t queue_index)
 {
     // 线程获取自己专属的资源引用，避免每次查找
@@ -55,6 +238,7 @@ void ThreadPool::worker_loop(size_t queue_index)
     // 注意：mutex 和 condition_variable 是 unique_ptr，所以是 unique_ptr 引用
     std::unique_ptr<std::mutex> &my_mutex = queue_mutexes_[queue_index];
     std::unique_ptr<std::condition_variable> &my_condition = conditions_[queue_index];
+    WorkerState &my_state = *worker_states_[queue_index];
 
     for (;;)
     {
@@ -65,20 +249,30 @@ void ThreadPool::worker_loop(size_t queue_index)
             std::unique_lock<std::mutex> lock(*my_mutex);
 
             // 使用条件变量等待：线程在此挂起，直到被通知 (notify) 且满足条件
-            my_condition->wait(lock, [this, &my_queue]
+            my_condition->wait(lock, [this, &my_queue, &my_state]
                               {
-                // 条件：线程池停止 或 自己的队列非空
-                return this->stop_.load() || !my_queue.empty(); }); // 如果线程池停止或者队列不为空，直接返回执行下面代码 否则（线程池未停止、任务队列为空）挂起等待；
+                // 条件：线程池停止 或 线程退役 或 自己的队列非空
+                return this->stop_.load() || my_state.retiring || !my_queue.empty(); }); // 如果线程池停止或者队列不为空，直接返回执行下面代码 否则（线程池未停止、任务队列为空）挂起等待；
 
-            // 优雅退出：如果线程池停止，且队列中已无任务，则退出循环
-            if (this->stop_ && my_queue.empty())
+            // 优雅退出：如果线程池停止或本线程退役，且队列中已无任务，则退出循环
+            if (my_queue.empty())
+            {
+                my_state.running = false;
+                my_state.retiring = false;
                 return;
+            }
 
             // 从队列头部取出任务
             task = std::move(my_queue.front()); // 移动赋值，避免拷贝造成的性能下降；
             my_queue.pop();
         } // 锁自动释放
 
+        // 记录当前任务信息，供看门狗检测卡死
+        my_state.key = task.key;
+        my_state.msgid = task.msgid;
+        long long start_ns = now_ns();
+        my_state.task_start_ns = start_ns;
+
         // 关键：在锁外执行任务，避免阻塞队列，影响其他线程的投递操作
         try
         {
@@ -92,5 +286,266 @@ void ThreadPool::worker_loop(size_t queue_index)
         {
             std::cerr << "[Worker " << queue_index << "] Caught unknown exception." << std::endl;
         }
+
+        // 任务结束：先清除开始时间，再清除卡死标记（与 check_worker 的复核顺序配合）
+        my_state.task_start_ns = 0;
+        my_state.last_busy_ns = now_ns();
+        if (task.vshard >= 0)
+        {
+            // 分片任务全部完成后才允许迁移
+            vshards_[task.vshard]->pending--;
+        }
+        if (my_state.stalled.exchange(false))
+        {
+            std::cerr << "[Watchdog] Worker " << queue_index << " 已恢复，key=" << task.key
+                      << " msgid=" << task.msgid << " 总耗时 "
+                      << (my_state.last_busy_ns - start_ns) / 1000000 << " ms" << std::endl;
+        }
+    }
+}
+
+void ThreadPool::start_worker(size_t index)
+{
+    WorkerState &state = *worker_states_[index];
+    {
+        std::lock_guard<std::mutex> lock(*queue_mutexes_[index]);
+        if (state.running)
+        {
+            // 退役中的线程还没退出，撤销退役即可
+            state.retiring = false;
+            return;
+        }
+    }
+    // 回收之前已退出的线程
+    if (workers_[index].joinable())
+    {
+        workers_[index].join();
+    }
+    {
+        std::lock_guard<std::mutex> lock(*queue_mutexes_[index]);
+        state.running = true;
+        state.retiring = false;
+    }
+    state.last_busy_ns = now_ns();
+    workers_[index] = std::thread(&ThreadPool::worker_loop, this, index); // 传入回调函数以及相关参数
+}
+
+void ThreadPool::check_scaling(long long now_ns)
+{
+    size_t active = active_threads_.load();
+    size_t queued = queued_tasks();
+
+    // 扩容：平均积压持续超过阈值
+    if (active < options_.max_threads && queued > options_.scale_up_queue_depth * active)
+    {
+        long long sustain_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(options_.scale_up_sustain).count();
+        if (overload_since_ns_ == 0)
+        {
+            overload_since_ns_ = now_ns;
+        }
+        else if (now_ns - overload_since_ns_ >= sustain_ns)
+        {
+            scale_up(queued);
+            overload_since_ns_ = 0;
+            last_scale_ns_ = now_ns;
+        }
+        return;
+    }
+    overload_since_ns_ = 0;
+
+    // 缩容：没有积压，且超过一半的活跃线程空闲超时，每个 idle_timeout 最多缩一个
+    long long idle_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(options_.idle_timeout).count();
+    if (active <= options_.min_threads || queued != 0 || now_ns - last_scale_ns_ < idle_ns)
+        return;
+    size_t idle = 0;
+    for (size_t i = 0; i < active; ++i)
+    {
+        const WorkerState &state = *worker_states_[i];
+        if (state.task_start_ns.load() == 0 && now_ns - state.last_busy_ns.load() >= idle_ns)
+            idle++;
+    }
+    if (idle * 2 > active)
+    {
+        scale_down();
+        last_scale_ns_ = now_ns;
+    }
+}
+
+void ThreadPool::scale_up(size_t queued)
+{
+    std::lock_guard<std::mutex> lock(scale_mutex_);
+    size_t active = active_threads_.load();
+    if (stop_ || active >= options_.max_threads)
+        return;
+    // 先启动线程再发布新的活跃数，保证映射到的线程一定在运行
+    start_worker(active);
+    active_threads_ = active + 1;
+    scale_up_events_++;
+    std::cout << "[ThreadPool] 扩容 " << active << " -> " << active + 1
+              << "，队列积压 " << queued << " 个任务" << std::endl;
+}
+
+void ThreadPool::scale_down()
+{
+    std::lock_guard<std::mutex> lock(scale_mutex_);
+    size_t active = active_threads_.load();
+    if (stop_ || active <= options_.min_threads)
+        return;
+    // 先缩小映射范围，空闲的虚拟分片在下次投递时迁走；退役线程清空队列后自行退出
+    size_t index = active - 1;
+    active_threads_ = index;
+    {
+        std::lock_guard<std::mutex> queue_lock(*queue_mutexes_[index]);
+        worker_states_[index]->retiring = true;
+    }
+    conditions_[index]->notify_one();
+    scale_down_events_++;
+    std::cout << "[ThreadPool] 缩容 " << active << " -> " << index << std::endl;
+}
+
+size_t ThreadPool::queued_tasks() const
+{
+    size_t total = 0;
+    for (size_t i = 0; i < num_threads_; ++i)
+    {
+        std::lock_guard<std::mutex> lock(*queue_mutexes_[i]);
+        total += sharded_queues_[i].size();
+    }
+    return total;
+}
+
+ThreadPool::Stats ThreadPool::stats() const
+{
+    Stats s;
+    s.active_threads = active_threads_.load();
+    s.min_threads = options_.min_threads;
+    s.max_threads = options_.max_threads;
+    s.queued_tasks = queued_tasks();
+    s.scale_up_events = scale_up_events_.load();
+    s.scale_down_events = scale_down_events_.load();
+    s.stall_events = stall_count_.load();
+    s.pending_timers = timer_wheel_.size();
+    return s;
+}
+
+void ThreadPool::timer_loop()
+{
+    while (!stop_)
+    {
+        std::this_thread::sleep_for(timer_wheel_.tick());
+        for (auto &timer : timer_wheel_.advance())
+        {
+            try
+            {
+                auto func = timer.func;
+                push_keyed(timer.key, [func]
+                           { (*func)(); }, 0);
+            }
+            catch (const std::runtime_error &)
+            {
+                // 线程池已停止，剩余的定时任务丢弃
+                return;
+            }
+        }
+    }
+}
+
+void ThreadPool::start_watchdog(std::chrono::milliseconds threshold, bool reroute_on_stall)
+{
+    install_stack_dumper();
+    reroute_on_stall_ = reroute_on_stall;
+    stall_threshold_ms_ = threshold.count();
+    if (!monitor_thread_.joinable())
+    {
+        monitor_thread_ = std::thread(&ThreadPool::monitor_loop, this);
+    }
+    else
+    {
+        // 监控线程已在运行（弹性模式），唤醒它按新的阈值调整检测周期
+        std::lock_guard<std::mutex> lock(monitor_mutex_);
+        monitor_cond_.notify_all();
+    }
+    std::cout << "ThreadPool watchdog started, threshold " << threshold.count() << " ms"
+              << (reroute_on_stall ? " (reroute on stall)." : ".") << std::endl;
+}
+
+void ThreadPool::monitor_loop()
+{
+    bool elastic = options_.min_threads < options_.max_threads;
+    std::unique_lock<std::mutex> lock(monitor_mutex_);
+    while (!stop_)
+    {
+        // 看门狗检测周期取阈值的 1/4，保证超时后能及时发现；伸缩采样周期 100ms
+        long long threshold_ms = stall_threshold_ms_.load();
+        auto interval = std::chrono::milliseconds(100);
+        if (threshold_ms > 0)
+        {
+            auto watchdog_interval = std::max(std::chrono::milliseconds(threshold_ms / 4), std::chrono::milliseconds(10));
+            interval = elastic ? std::min(interval, watchdog_interval) : watchdog_interval;
+        }
+        monitor_cond_.wait_for(lock, interval);
+        if (stop_)
+            break;
+
+        long long now = now_ns();
+        if (stall_threshold_ms_.load() > 0)
+        {
+            for (size_t i = 0; i < num_threads_; ++i)
+            {
+                check_worker(i, now);
+            }
+        }
+        if (elastic)
+        {
+            check_scaling(now);
+        }
+    }
+}
+
+void ThreadPool::check_worker(size_t queue_index, long long now_ns)
+{
+    WorkerState &state = *worker_states_[queue_index];
+    long long start = state.task_start_ns.load();
+    if (start == 0 || state.stalled.load())
+        return; // 空闲，或者这个任务已经报告过
+
+    long long threshold_ns = stall_threshold_ms_.load() * 1000000;
+    if (now_ns - start < threshold_ns)
+        return;
+
+    state.stalled = true;
+    // 复核：标记期间任务可能已经结束，避免把空闲线程误标为卡死
+    if (state.task_start_ns.load() != start)
+    {
+        state.stalled = false;
+        return;
+    }
+    stall_count_++;
+
+    size_t depth = 0;
+    {
+        std::lock_guard<std::mutex> lock(*queue_mutexes_[queue_index]);
+        depth = sharded_queues_[queue_index].size();
+    }
+    std::cerr << "[Watchdog] Worker " << queue_index << " 任务执行超时："
+              << " key=" << state.key.load()
+              << " msgid=" << state.msgid.load()
+              << " 已运行 " << (now_ns - start) / 1000000 << " ms"
+              << " 队列积压 " << depth << " 个任务，调用栈如下：" << std::endl;
+    // 让卡死的线程自己打印调用栈（近似：信号到达时任务可能刚好结束）
+    pthread_kill(workers_[queue_index].native_handle(), SIGUSR2);
+}
+
+size_t ThreadPool::route_around_stall(size_t index) const
+{
+    size_t active = active_threads_.load();
+    for (size_t i = 0; i < active; ++i)
+    {
+        size_t candidate = (index + i) % active;
+        if (!worker_states_[candidate]->stalled.load())
+        {
+            return candidate;
+        }
     }
+    return index % active;
 }
@@ -0,0 +1,196 @@
+#include "TimerWheel.h"
+
+#include <algorithm>
+
+TimerWheel::TimerWheel(std::chrono::milliseconds tick)
+    : tick_(tick.count() > 0 ? tick : std::chrono::milliseconds(1)),
+      start_(std::chrono::steady_clock::now()),
+      slots_(kLevels * kSlots, kNil)
+{
+}
+
+uint64_t TimerWheel::now_tick() const
+{
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_);
+    return static_cast<uint64_t>(elapsed.count() / tick_.count());
+}
+
+TimerId TimerWheel::add(long long key, std::chrono::milliseconds delay, std::chrono::milliseconds period, Callback func)
+{
+    // 向上取整到 tick，保证不会提前触发
+    uint64_t delay_ticks = delay.count() <= 0 ? 0 : (delay.count() + tick_.count() - 1) / tick_.count();
+    uint64_t period_ticks = period.count() <= 0 ? 0 : std::max<uint64_t>(1, (period.count() + tick_.count() - 1) / tick_.count());
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    uint32_t index;
+    if (!free_nodes_.empty())
+    {
+        index = free_nodes_.back();
+        free_nodes_.pop_back();
+    }
+    else
+    {
+        index = static_cast<uint32_t>(nodes_.size());
+        nodes_.emplace_back();
+    }
+
+    Node &node = nodes_[index];
+    node.expire_tick = std::max(current_tick_, now_tick()) + delay_ticks;
+    node.period_ticks = period_ticks;
+    node.key = key;
+    node.func = std::make_shared<Callback>(std::move(func));
+    place(index);
+    size_++;
+    return (static_cast<uint64_t>(node.generation) << 32) | index;
+}
+
+bool TimerWheel::cancel(TimerId id)
+{
+    uint32_t index = static_cast<uint32_t>(id & 0xffffffff);
+    uint32_t generation = static_cast<uint32_t>(id >> 32);
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (index >= nodes_.size())
+        return false;
+    Node &node = nodes_[index];
+    if (node.generation != generation || !node.linked)
+        return false;
+    unlink(index);
+    release(index);
+    size_--;
+    return true;
+}
+
+std::vector<TimerWheel::Expired> TimerWheel::advance()
+{
+    std::vector<Expired> expired;
+    std::lock_guard<std::mutex> lock(mtx_);
+    uint64_t target = now_tick();
+    while (current_tick_ <= target)
+    {
+        process_tick(expired);
+        current_tick_++;
+    }
+    return expired;
+}
+
+size_t TimerWheel::size() const
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    return size_;
+}
+
+void TimerWheel::place(uint32_t index)
+{
+    Node &node = nodes_[index];
+    uint64_t expire = std::max(node.expire_tick, current_tick_);
+    uint64_t diff = expire - current_tick_;
+
+    int level = 0;
+    while (level < kLevels - 1 && diff >= (1ull << (kSlotBits * (level + 1))))
+    {
+        level++;
+    }
+    // 超出时间轮范围的先挂在最高层最远的槽，级联时再重新计算
+    uint64_t span = 1ull << (kSlotBits * kLevels);
+    if (diff >= span)
+    {
+        expire = current_tick_ + span - 1;
+    }
+    uint32_t slot_index = static_cast<uint32_t>((expire >> (kSlotBits * level)) & (kSlots - 1));
+    link(index, static_cast<uint16_t>(level * kSlots + slot_index));
+}
+
+void TimerWheel::link(uint32_t index, uint16_t slot)
+{
+    Node &node = nodes_[index];
+    node.slot = slot;
+    node.prev = kNil;
+    node.next = slots_[slot];
+    if (node.next != kNil)
+    {
+        nodes_[node.next].prev = index;
+    }
+    slots_[slot] = index;
+    node.linked = true;
+}
+
+void TimerWheel::unlink(uint32_t index)
+{
+    Node &node = nodes_[index];
+    if (node.prev != kNil)
+    {
+        nodes_[node.prev].next = node.next;
+    }
+    else
+    {
+        slots_[node.slot] = node.next;
+    }
+    if (node.next != kNil)
+    {
+        nodes_[node.next].prev = node.prev;
+    }
+    node.prev = node.next = kNil;
+    node.linked = false;
+}
+
+void TimerWheel::release(uint32_t index)
+{
+    Node &node = nodes_[index];
+    node.func.reset();
+    node.generation++;
+    if (node.generation == 0)
+    {
+        node.generation = 1; // 保证句柄永远不为 0
+    }
+    free_nodes_.push_back(index);
+}
+
+void TimerWheel::cascade(int level, uint32_t slot_index)
+{
+    uint16_t slot = static_cast<uint16_t>(level * kSlots + slot_index);
+    uint32_t index = slots_[slot];
+    slots_[slot] = kNil;
+    while (index != kNil)
+    {
+        uint32_t next = nodes_[index].next;
+        nodes_[index].linked = false;
+        place(index);
+        index = next;
+    }
+}
+
+void TimerWheel::process_tick(std::vector<Expired> &expired)
+{
+    // 低位归零时，把上一层对应槽的定时器拆分到下层
+    for (int level = 1; level < kLevels; ++level)
+    {
+        if ((current_tick_ & ((1ull << (kSlotBits * level)) - 1)) != 0)
+            break;
+        cascade(level, static_cast<uint32_t>((current_tick_ >> (kSlotBits * level)) & (kSlots - 1)));
+    }
+
+    uint16_t slot = static_cast<uint16_t>(current_tick_ & (kSlots - 1));
+    uint32_t index = slots_[slot];
+    slots_[slot] = kNil;
+    while (index != kNil)
+    {
+        Node &node = nodes_[index];
+        uint32_t next = node.next;
+        node.linked = false;
+        node.prev = node.next = kNil;
+        expired.push_back({node.key, node.func});
+        if (node.period_ticks > 0)
+        {
+            // 周期定时器按固定频率重新挂入，句柄不变；落后太多时跳过错过的周期
+            node.expire_tick = std::max(node.expire_tick + node.period_ticks, current_tick_ + 1);
+            place(index);
+        }
+        else
+        {
+            release(index);
+            size_--;
+        }
+        index = next;
+    }
+}
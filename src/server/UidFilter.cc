@@ -0,0 +1,86 @@
+#include "UidFilter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+UidFilter::UidFilter(size_t expected_uids, double false_positive_rate, std::chrono::milliseconds negative_ttl)
+    : expected_(std::max<size_t>(1, expected_uids)), negative_ttl_(negative_ttl), shards_(kShards)
+{
+    // m = -n ln(p) / ln(2)^2，k = m / n * ln(2)
+    const double ln2 = std::log(2.0);
+    double bits = -static_cast<double>(expected_) * std::log(false_positive_rate) / (ln2 * ln2);
+    bit_count_ = std::max<size_t>(64, static_cast<size_t>(bits));
+    hashes_ = std::max(1, static_cast<int>(std::lround(bit_count_ / static_cast<double>(expected_) * ln2)));
+    bits_ = std::make_unique<std::atomic<uint64_t>[]>((bit_count_ + 63) / 64);
+}
+
+// splitmix64：连续的自增 uid 也能均匀分布
+uint64_t UidFilter::hash_of(int uid)
+{
+    uint64_t x = static_cast<uint32_t>(uid) + 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+void UidFilter::add(int uid)
+{
+    uint64_t hash = hash_of(uid);
+    for (int i = 0; i < hashes_; ++i)
+    {
+        size_t bit = bit_of(hash, i);
+        bits_[bit / 64].fetch_or(1ull << (bit % 64), std::memory_order_relaxed);
+    }
+    if (++added_ == expected_ + 1)
+        std::cerr << "[UidFilter] uid 数量超过预期容量 " << expected_ << "，误判率将上升" << std::endl;
+
+    Shard &shard = shard_of(uid);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    shard.expires.erase(uid);
+}
+
+bool UidFilter::mayExist(int uid)
+{
+    if (!ready_)
+        return true;
+    uint64_t hash = hash_of(uid);
+    for (int i = 0; i < hashes_; ++i)
+    {
+        size_t bit = bit_of(hash, i);
+        if (!(bits_[bit / 64].load(std::memory_order_relaxed) & (1ull << (bit % 64))))
+            return false;
+    }
+
+    Shard &shard = shard_of(uid);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    auto it = shard.expires.find(uid);
+    if (it == shard.expires.end())
+        return true;
+    if (it->second <= Clock::now())
+    {
+        shard.expires.erase(it);
+        return true;
+    }
+    return false;
+}
+
+void UidFilter::markMissing(int uid)
+{
+    Shard &shard = shard_of(uid);
+    Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    if (shard.expires.size() >= kMaxNegativePerShard)
+    {
+        std::erase_if(shard.expires, [now](const auto &entry)
+                      { return entry.second <= now; });
+        if (shard.expires.size() >= kMaxNegativePerShard)
+            shard.expires.clear();
+    }
+    shard.expires[uid] = now + negative_ttl_;
+}
+
+void UidFilter::setReady()
+{
+    ready_ = true;
+}
@@ -1,7 +1,80 @@
 #include "UserDatamodel.h"
 #include "protocol.pb.h"
 
+#include <algorithm>
 #include <unordered_map>
+
+namespace
+{
+    const char *const kSelectPlayer = "select uid,level,exp,hp,mp,coin,x,y,z from Player where uid=?";
+    const char *const kSelectPlayerRange = "select uid,level,exp,hp,mp,coin,x,y,z from Player where uid>? order by uid limit ?";
+    const char *const kInsertPlayer = "insert into Player(uid,level,exp,hp,mp,coin,x,y,z) values (?,?,?,?,?,?,?,?,?)";
+    // 多行 upsert 与批量查询按 2 的幂分块，每个连接上每种语句最多缓存 log2(kMaxUpsertRows)+1 条
+    const size_t kMaxUpsertRows = 256;
+
+    // Player 表一行，字段顺序与 select/insert 的列顺序相同
+    struct PlayerRow
+    {
+        int uid = 0, level = 0, exp = 0, hp = 0, mp = 0, coin = 0;
+        float x = 0, y = 0, z = 0;
+
+        explicit PlayerRow(const msg::PlayerAttr &attr = msg::PlayerAttr())
+            : uid(attr.uid()), level(attr.level()), exp(attr.exp()), hp(attr.hp()), mp(attr.mp()), coin(attr.coin()),
+              x(attr.x()), y(attr.y()), z(attr.z())
+        {
+        }
+
+        // 从 first 开始绑定 9 列
+        void bind(MySQLBinds &binds, size_t first)
+        {
+            binds.setInt(first, &uid);
+            binds.setInt(first + 1, &level);
+            binds.setInt(first + 2, &exp);
+            binds.setInt(first + 3, &hp);
+            binds.setInt(first + 4, &mp);
+            binds.setInt(first + 5, &coin);
+            binds.setFloat(first + 6, &x);
+            binds.setFloat(first + 7, &y);
+            binds.setFloat(first + 8, &z);
+        }
+
+        void to(msg::PlayerAttr &out) const
+        {
+            out.set_uid(uid);
+            out.set_level(level);
+            out.set_exp(exp);
+            out.set_hp(hp);
+            out.set_mp(mp);
+            out.set_coin(coin);
+            out.set_x(x);
+            out.set_y(y);
+            out.set_z(z);
+        }
+    };
+
+    std::string selectInSql(size_t uids)
+    {
+        std::string sql = "select uid,level,exp,hp,mp,coin,x,y,z from Player where uid in (";
+        for (size_t i = 0; i < uids; ++i)
+        {
+            sql += i ? ",?" : "?";
+        }
+        sql += ")";
+        return sql;
+    }
+
+    std::string upsertSql(size_t rows)
+    {
+        std::string sql = "insert into Player(uid,level,exp,hp,mp,coin,x,y,z) values ";
+        for (size_t i = 0; i < rows; ++i)
+        {
+            sql += i ? ",(?,?,?,?,?,?,?,?,?)" : "(?,?,?,?,?,?,?,?,?)";
+        }
+        sql += " on duplicate key update level=values(level),exp=values(exp),hp=values(hp),mp=values(mp),"
+               "coin=values(coin),x=values(x),y=values(y),z=values(z)";
+        return sql;
+    }
+}
 UserDatamodel::UserDatamodel()
 {
 }
@@ -10,55 +83,85 @@ UserDatamodel &UserDatamodel::instance()
     static UserDatamodel userdatamodel;
     return userdatamodel;
 }
-bool UserDatamodel::QueryUserData(msg::PlayerAttr &playerdata)
+bool UserDatamodel::QueryUserData(msg::PlayerAttr &playerdata, bool *not_found)
 {
-    char sql[1024] = {0};
-    snprintf(sql, sizeof sql, "select * from Player where uid=%d", playerdata.uid());
     MySQL mysql;
     if (mysql.connect())
     {
         // 连接成功 查询玩家数据
-        if (MYSQL_RES *res = mysql.query(sql))
+        MYSQL_STMT *stmt = mysql.prepare(kSelectPlayer);
+        int uid = playerdata.uid();
+        MySQLBinds params(1);
+        params.setInt(0, &uid);
+        PlayerRow row;
+        MySQLBinds results(9);
+        row.bind(results, 0);
+        if (stmt && mysql.execute(stmt, &params, &results))
         {
-            // 查询到结果
-            MYSQL_ROW row = mysql_fetch_row(res);
-            if (row != nullptr)
+            if (mysql.fetch(stmt))
             {
                 // 读取玩家数据
-                playerdata.set_level(std::stoi(row[1]));
-                playerdata.set_exp(std::stoi(row[2]));
-                playerdata.set_hp(std::stoi(row[3]));
-                playerdata.set_mp(std::stoi(row[4]));
-                playerdata.set_coin(std::stoi(row[5]));
-                playerdata.set_x(std::stof(row[6]));
-                playerdata.set_y(std::stof(row[7]));
-                playerdata.set_z(std::stof(row[8]));
-                mysql_free_result(res);
+                row.to(playerdata);
                 return true;
             }
-            else
-            {
-                // 没查询到玩家数据
-                mysql_free_result(res);
-                std::cout << "玩家数据不存在" << std::endl;
-                return false;
-            }
+            // 没查询到玩家数据
+            if (not_found)
+                *not_found = true;
+            std::cout << "玩家数据不存在" << std::endl;
+            return false;
         }
     }
     return false;
 }
 
+bool UserDatamodel::QueryUserDataBatch(const std::vector<int> &uids, std::vector<msg::PlayerAttr> &out)
+{
+    if (uids.empty())
+        return true;
+    MySQL mysql;
+    if (!mysql.connect())
+        return false;
+    size_t pos = 0;
+    while (pos < uids.size())
+    {
+        // 块大小取 2 的幂，不足的位置重复最后一个 uid 补齐（in 中重复的值不会产生重复行），
+        // 一个房间的玩家一次往返查完
+        size_t count = std::min(kMaxUpsertRows, uids.size() - pos);
+        size_t slots = 1;
+        while (slots < count)
+            slots *= 2;
+        MYSQL_STMT *stmt = mysql.prepare(selectInSql(slots));
+        std::vector<int> params_uid(slots);
+        MySQLBinds params(slots);
+        for (size_t i = 0; i < slots; ++i)
+        {
+            params_uid[i] = uids[pos + std::min(i, count - 1)];
+            params.setInt(i, &params_uid[i]);
+        }
+        PlayerRow row;
+        MySQLBinds results(9);
+        row.bind(results, 0);
+        if (!stmt || !mysql.execute(stmt, &params, &results))
+            return false;
+        while (mysql.fetch(stmt))
+        {
+            row.to(out.emplace_back());
+        }
+        pos += count;
+    }
+    return true;
+}
+
 bool UserDatamodel::InsertUserData(msg::PlayerAttr &playerdata)
 {
     MySQL mysql;
     if (mysql.connect())
     {
-        char sql[1024] = {0};
-        snprintf(sql, sizeof sql, "Insert into Player(uid,level,exp,hp,mp,coin,x,y,z)"
-                                  "Values (%d,%d,%d,%d,%d,%d,%f,%f,%f);",
-                 playerdata.uid(), playerdata.level(), playerdata.exp(), playerdata.hp(), playerdata.mp(),
-                 playerdata.coin(), playerdata.x(), playerdata.y(), playerdata.z());
-        if (mysql.update(sql))
+        MYSQL_STMT *stmt = mysql.prepare(kInsertPlayer);
+        PlayerRow row(playerdata);
+        MySQLBinds params(9);
+        row.bind(params, 0);
+        if (stmt && mysql.execute(stmt, &params))
         {
             // 插入数据成功
             return true;
@@ -71,45 +174,74 @@ bool UserDatamodel::InsertUserData(msg::PlayerAttr &playerdata)
     return false;
 }
 
-bool UserDatamodel::UpdateUserData(msg::PlayerAttr &playerdata)
+bool UserDatamodel::UpsertUserDataBatch(const std::vector<msg::PlayerAttr> &players)
 {
+    if (players.empty())
+        return true;
     MySQL mysql;
-    if (mysql.connect())
+    if (!mysql.connect())
+    {
+        std::cerr << "[MySQL] 连接失败，无法批量写入 " << players.size() << " 个玩家" << std::endl;
+        return false;
+    }
+    // 每次取不超过剩余行数的最大 2 的幂作为一块，语句按块大小缓存复用；
+    // 多于一块时放在一个事务里，整批只提交一次
+    bool transaction = players.size() > kMaxUpsertRows || (players.size() & (players.size() - 1)) != 0;
+    if (transaction && !mysql.begin())
     {
-        char sql[1024] = {0};
-        // ⚠️ 确保 WHERE uid = ...，否则会更新整个表！
-        snprintf(sql, sizeof(sql),
-                 "UPDATE Player SET "
-                 "level=%d, "
-                 "exp=%d, "
-                 "hp=%d, "
-                 "mp=%d, "
-                 "coin=%d, "
-                 "x=%f, "
-                 "y=%f, "
-                 "z=%f "
-                 "WHERE uid=%d;",
-                 playerdata.level(),
-                 playerdata.exp(),
-                 playerdata.hp(),
-                 playerdata.mp(),
-                 playerdata.coin(),
-                 playerdata.x(),
-                 playerdata.y(),
-                 playerdata.z(),
-                 playerdata.uid());
-        // 调用封装好的更新接口
-        if (mysql.update(sql))
+        std::cerr << "[MySQL] 开启事务失败，无法批量写入 " << players.size() << " 个玩家" << std::endl;
+        return false;
+    }
+    size_t pos = 0;
+    while (pos < players.size())
+    {
+        size_t rows = kMaxUpsertRows;
+        while (rows > players.size() - pos)
+            rows /= 2;
+        MYSQL_STMT *stmt = mysql.prepare(upsertSql(rows));
+        std::vector<PlayerRow> values;
+        values.reserve(rows);
+        MySQLBinds params(rows * 9);
+        for (size_t i = 0; i < rows; ++i)
         {
-            std::cout << "[MySQL] 玩家 " << playerdata.uid() << " 数据更新成功。" << std::endl;
-            return true;
+            values.emplace_back(players[pos + i]);
+            values.back().bind(params, i * 9);
         }
-        else
+        if (!stmt || !mysql.execute(stmt, &params))
         {
-            std::cerr << "[MySQL] 玩家 " << playerdata.uid() << " 数据更新失败: " << sql << std::endl;
+            std::cerr << "[MySQL] 批量写入 " << players.size() << " 个玩家失败" << std::endl;
             return false;
         }
+        pos += rows;
+    }
+    if (transaction && !mysql.commit())
+    {
+        std::cerr << "[MySQL] 批量写入 " << players.size() << " 个玩家提交失败" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool UserDatamodel::LoadUserDataRange(int after_uid, int limit, std::vector<msg::PlayerAttr> &out)
+{
+    MySQL mysql;
+    if (mysql.connect())
+    {
+        MYSQL_STMT *stmt = mysql.prepare(kSelectPlayerRange);
+        MySQLBinds params(2);
+        params.setInt(0, &after_uid);
+        params.setInt(1, &limit);
+        PlayerRow row;
+        MySQLBinds results(9);
+        row.bind(results, 0);
+        if (stmt && mysql.execute(stmt, &params, &results))
+        {
+            while (mysql.fetch(stmt))
+            {
+                row.to(out.emplace_back());
+            }
+            return true;
+        }
     }
-    std::cerr << "[MySQL] 连接失败，无法更新玩家 " << playerdata.uid() << " 数据。" << std::endl;
     return false;
-}
\ No newline at end of file
+}
@@ -1,5 +1,16 @@
 #include "Usermodel.h"
 
+#include <algorithm>
+
+namespace
+{
+    const char *const kInsertUser = "INSERT INTO User(name,passwd) VALUES(?,?)";
+    const char *const kSelectUser = "SELECT name,passwd FROM User WHERE uid=?";
+    const char *const kSelectUids = "SELECT uid FROM User WHERE uid>? ORDER BY uid LIMIT ?";
+    // 用户名与密码的结果缓冲区
+    const size_t kFieldCapacity = 256;
+}
+
 
 // 单例模式
 Usermodel &Usermodel::getinstance()
@@ -11,18 +22,22 @@ Usermodel &Usermodel::getinstance()
 // 注册业务，向表中新添加一个user
 bool Usermodel::zhuce(GameUser &user)
 {
-    // 拼sql语句
-    char sql[1024] = {0};
-    snprintf(sql, sizeof sql, "INSERT INTO User(name,passwd) VALUES('%s','%s')", user.name().c_str(), user.paswd().c_str());
     // 连接数据库
     MySQL mysql;
     if (mysql.connect())
     {
+        // 用户名和密码作为参数传给服务端，不拼进 SQL 文本
+        MYSQL_STMT *stmt = mysql.prepare(kInsertUser);
+        std::string name = user.name();
+        std::string passwd = user.paswd();
+        MySQLBinds params(2);
+        params.setString(0, name);
+        params.setString(1, passwd);
         // 连接成功
-        if (mysql.update(sql))
+        if (stmt && mysql.execute(stmt, &params))
         {
             // 获取注册用户的id
-            user.setid(mysql_insert_id(mysql.getConnection()));
+            user.setid(mysql_stmt_insert_id(stmt));
             return true;
         }
         else
@@ -38,34 +53,59 @@ bool Usermodel::zhuce(GameUser &user)
 // 登录业务，向表中查询id与pwd是否对应
 bool Usermodel::Login(GameUser &user)
 {
-    char sql[1024] = {0};
-    snprintf(sql, sizeof sql, "SELECT * FROM User WHERE uid=%d", user.clientid());
     MySQL mysql;
     if (mysql.connect())
     {
         // 数据库连接成功
-        if (MYSQL_RES *res = mysql.query(sql))
+        MYSQL_STMT *stmt = mysql.prepare(kSelectUser);
+        int uid = user.clientid();
+        MySQLBinds params(1);
+        params.setInt(0, &uid);
+        char name[kFieldCapacity];
+        char passwd[kFieldCapacity];
+        MySQLBinds results(2);
+        results.setBuffer(0, name, sizeof name);
+        results.setBuffer(1, passwd, sizeof passwd);
+        if (stmt && mysql.execute(stmt, &params, &results))
         {
             // 查找成功
-            //std::cout << "[DEBUG] 执行 SQL: " << sql << std::endl;
-            //std::cout << "数据库查询成功" << std::endl;
-            MYSQL_ROW row = mysql_fetch_row(res);
-            if (row)
+            if (mysql.fetch(stmt))
             {
-                //std::cout << "数据库查询到结果" << std::endl;
-                std::string passwd = row[2];
-                std::string name = row[1];
-                user.setname(name);
-                if (passwd == user.paswd())
+                user.setname(std::string(name, std::min<size_t>(results.length(0), sizeof name)));
+                if (std::string(passwd, std::min<size_t>(results.length(1), sizeof passwd)) == user.paswd())
                 {
                     // 密码正确 登录成功；
-                    mysql_free_result(res);
                     return true;
                 }
+                return false;
             }
             std::cout << "数据库没有查询到结果" << std::endl;
-            mysql_free_result(res);
         }
     }
     return false;
-}
\ No newline at end of file
+}
+
+// 按 uid 顺序分段读取已注册的 uid，用于构建已知 uid 过滤器
+bool Usermodel::loadUids(int after_uid, int limit, std::vector<int> &out)
+{
+    MySQL mysql;
+    if (mysql.connect())
+    {
+        MYSQL_STMT *stmt = mysql.prepare(kSelectUids);
+        MySQLBinds params(2);
+        params.setInt(0, &after_uid);
+        params.setInt(1, &limit);
+        int uid = 0;
+        MySQLBinds results(1);
+        results.setInt(0, &uid);
+        if (stmt && mysql.execute(stmt, &params, &results))
+        {
+            while (mysql.fetch(stmt))
+            {
+                out.push_back(uid);
+            }
+            return true;
+        }
+    }
+    return false;
+}
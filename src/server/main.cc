@@ -5,17 +5,62 @@
 #include "MessageDispatcher.h"
 #include "PlayerDataManager.h" // 同步数据的类
 #include "RoomManager.h"
-#include <cppkafka/consumer.h> // Kafka 消费相关头文件
-#include <cppkafka/configuration.h>
-int main()
+#include "DB.h"
+#include "PlayerSyncConsumer.h" // Kafka 消费，同步到 MySQL
+int main(int argc, char *argv[])
 {
   try
   {
     boost::asio::io_context io;
 
-    // 1️⃣ 创建工作线程池
-    const size_t num_workers = std::thread::hardware_concurrency();
-    ThreadPool worker_pool(num_workers);
+    // 异步 Redis 客户端挂在 io_context 上，玩家数据写回不再阻塞工作线程。
+    // 先于工作线程池构造：退出时线程池先析构（等正在执行的任务结束），解除绑定后才析构客户端，
+    // 析构时在途命令的回调不再投递到已析构的线程池
+    AsyncRedis async_redis(io, "127.0.0.1", 6379);
+    struct Unbind
+    {
+      ~Unbind()
+      {
+        PlayerDataManager::getInstance().bindAsyncRedis(nullptr);
+        PlayerDataManager::getInstance().unbindWorkerPool();
+      }
+    } unbind;
+
+    // 1️⃣ 创建工作线程池（弹性：闲时收缩到一半核数，高峰时最多扩到两倍核数）
+    const size_t num_workers = std::max(2u, std::thread::hardware_concurrency());
+    ElasticOptions pool_opts;
+    pool_opts.min_threads = num_workers / 2;
+    pool_opts.max_threads = num_workers * 2;
+    ThreadPool worker_pool(pool_opts);
+    // 看门狗：任务超过 1s 视为卡死（Redis 连接池 wait_timeout 为 2s），只报警不改道
+    worker_pool.start_watchdog(std::chrono::milliseconds(1000), false);
+
+    // MySQL 连接池：最多每个工作线程一个连接，外加 kafka 同步线程
+    MySQLPool::Options mysql_opts;
+    mysql_opts.min_size = 4;
+    mysql_opts.max_size = pool_opts.max_threads + 8;
+    MySQLPool::instance().configure(mysql_opts);
+
+    // 玩家邮箱的异步消息在工作线程池上处理
+    PlayerDataManager::getInstance().bindWorkerPool(worker_pool);
+    async_redis.start();
+    PlayerDataManager::getInstance().bindAsyncRedis(&async_redis);
+    // Redis 玩家记录迁移到二进制格式：读兼容旧 hash，写入即转换；旧 key 全部改写后可切到 BINARY
+    PlayerDataManager::getInstance().setRedisFormat(RedisFormat::MIGRATE);
+    // 加经验与写回的 Lua 脚本（多个服务器进程共享 Redis 时读改写保持原子）
+    PlayerDataManager::getInstance().loadScripts();
+    // 已注册 uid 的 Bloom 过滤器，不存在的 uid 不再访问 Redis/MySQL
+    PlayerDataManager::getInstance().loadKnownUids();
+    // 缓存重建：Redis 清空或故障切换后用 --rebuild-cache 启动，先重建玩家缓存再接受连接；
+    // --rebuild-cache-only 只重建后退出（作为独立工具运行）
+    std::string mode = argc > 1 ? argv[1] : "";
+    if (mode == "--rebuild-cache" || mode == "--rebuild-cache-only")
+    {
+      PlayerDataManager::RebuildOptions rebuild_opts;
+      PlayerDataManager::RebuildStats rebuilt = PlayerDataManager::getInstance().rebuildCache(rebuild_opts);
+      if (mode == "--rebuild-cache-only")
+        return rebuilt.ok ? 0 : 1;
+    }
 
     // 2️⃣ 消息分发器
     MessageDispatcher &dispatcher = MessageDispatcher::instance(worker_pool);
@@ -37,56 +82,19 @@ int main()
     std::cout << "[GameServer] Started successfully." << std::endl;
 
     // 5️⃣ 启动 Kafka 消费线程（异步同步 Redis → MySQL）
+    // 按分区分发给多个同步线程并行写 MySQL，写出成功后才提交 offset
     std::thread kafka_thread([]()
                              {
             try
             {
-                cppkafka::Configuration config = {
-                    {"metadata.broker.list", "127.0.0.1:9092"},
-                    {"group.id", "game_server_consumer"},
-                    {"enable.auto.commit", true},
-                    {"auto.offset.reset", "earliest"}  // 从头开始消费（调试时有用）
-                };
-
-                cppkafka::Consumer consumer(config);
-                std::string topic = "playerdata_update";
-                consumer.subscribe({topic});
-
-                std::cout << "[KafkaConsumer] Started listening on topic: " << topic << std::endl;
-
-                // 消费循环
-                while (true)
-                {
-                    cppkafka::Message msg = consumer.poll();//从所分配到的队列中获取一条消息
-                    if (!msg) continue; // 无消息则继续
-                    if (msg.get_error())
-                    {
-                        if (!msg.is_eof())
-                            std::cerr << "[KafkaError] " << msg.get_error() << std::endl;
-                        continue;
-                    }
-
-                    // 解析消息内容
-                    std::string payload = msg.get_payload();
-                    std::istringstream iss(payload);
-                    std::string uid_str, field, value_str;
-
-                    if (std::getline(iss, uid_str, '|') &&
-                        std::getline(iss, field, '|') &&
-                        std::getline(iss, value_str))
-                    {
-                        int uid = std::stoi(uid_str);
-                        int value = std::stoi(value_str);
-                        std::cout << "[KafkaConsumer] Received message: " << payload << std::endl;
-
-                        // 调用同步函数
-                        PlayerDataManager::getInstance().syncToMySQL(uid, field, value);
-                    }
-                    else
-                    {
-                        std::cerr << "[KafkaConsumer] Invalid message format: " << payload << std::endl;
-                    }
-                }
+                PlayerSyncConsumer::Options options;
+                options.workers = 4;
+                // 写合并：500ms 窗口内同一玩家的多条消息只写一次 MySQL，最多 500 个玩家一批
+                options.window = std::chrono::milliseconds(500);
+                options.max_uids = 500;
+                PlayerSyncConsumer consumer(options, [](const std::vector<int> &uids)
+                                            { return PlayerDataManager::getInstance().syncToMySQL(uids); });
+                consumer.run();
             }
             catch (const std::exception &ex)
             {
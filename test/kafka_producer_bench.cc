@@ -0,0 +1,89 @@
+// kafka 生产者基准测试：每条消息 produce + flush（旧实现）与 KafkaPublisher 异步攒批的每秒推送数
+// 使用 librdkafka 自带的 mock broker（test.mock.num.brokers），不需要真实的 kafka
+// 编译：g++ -std=c++20 -O2 -I include/server test/kafka_producer_bench.cc src/server/KafkaPublisher.cc -lcppkafka -lrdkafka -lpthread -o kafka_producer_bench
+#include "KafkaPublisher.h"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+    const int kThreads = 4;                // 模拟并发修改属性的工作线程
+    const int kFlushMessages = 2000;       // 旧实现每条都等确认，消息数少一些
+    const int kAsyncMessages = 200000;
+    const std::string kTopic = "playerdata_update";
+
+    std::string payload(int i)
+    {
+        return std::to_string(10000 + i % 1000) + "|exp|" + std::to_string(i);
+    }
+
+    template <typename F>
+    double run(int messages, F &&send)
+    {
+        Clock::time_point start = Clock::now();
+        std::vector<std::thread> threads;
+        for (int t = 0; t < kThreads; ++t)
+        {
+            threads.emplace_back([&, t]
+                                 {
+                for (int i = t; i < messages; i += kThreads)
+                {
+                    send(i);
+                } });
+        }
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+}
+
+int main()
+{
+    // 旧实现：produce 之后立即 flush，每条消息阻塞一次 broker 往返
+    {
+        cppkafka::Configuration config = {{"test.mock.num.brokers", 1}};
+        cppkafka::Producer producer(config);
+        std::mutex mtx; // 原实现共享一个 producer，flush 之间互相等待
+        double seconds = run(kFlushMessages, [&](int i)
+                             {
+            cppkafka::MessageBuilder builder(kTopic);
+            std::string msg = payload(i);
+            builder.payload(msg);
+            std::lock_guard<std::mutex> lock(mtx);
+            producer.produce(builder);
+            producer.flush(); });
+        std::cout << "produce + flush: " << kFlushMessages / seconds << " 条/秒" << std::endl;
+    }
+
+    // KafkaPublisher：只入队，后台攒批发送
+    {
+        KafkaPublisher::Options options;
+        options.brokers.clear();
+        options.topic = kTopic;
+        options.extra_config = {{"test.mock.num.brokers", "1"}};
+        KafkaPublisher publisher(options);
+        double enqueue_seconds = run(kAsyncMessages, [&](int i)
+                                     { publisher.publish(std::to_string(10000 + i % 1000), payload(i)); });
+        // 等待全部确认
+        Clock::time_point start = Clock::now();
+        while (publisher.stats().delivered + publisher.stats().failed < static_cast<size_t>(kAsyncMessages))
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        double total = enqueue_seconds + std::chrono::duration<double>(Clock::now() - start).count();
+        KafkaPublisher::Stats stats = publisher.stats();
+        std::cout << "KafkaPublisher 入队: " << kAsyncMessages / enqueue_seconds << " 条/秒，含确认: "
+                  << kAsyncMessages / total << " 条/秒（确认 " << stats.delivered << "，失败 " << stats.failed << "）" << std::endl;
+    }
+    return 0;
+}
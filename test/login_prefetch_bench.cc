@@ -0,0 +1,227 @@
+// 登录预取基准测试：登录后第一次查看背包（getPlayerAsync）的延迟，有/无预取（prefetchPlayer）对比。
+// 走真实的 PlayerDataManager（L1、玩家邮箱、异步 Redis、single-flight 加载）；需要本地 redis-server 127.0.0.1:6379，
+// 使用 uid 9000000 起的 key（开始和结束时删除）。kafka 不可用时变化事件落到本地 spill 目录。
+// 用测试内的 UserDatamodel / Usermodel 替换 MySQL（不链接 UserDatamodel.cc、Usermodel.cc），每次查询固定延迟 kMySQLLatency。
+// 场景：kRedisPercent 的玩家 Redis 中已有记录，其余需要查 MySQL；客户端收到登录响应后间隔 kClientGap 再查看背包，
+// kDisconnectPercent 的玩家登录后立即断开（cancelPrefetch），统计被跳过的 MySQL 查询
+// 编译：protoc -I proto --cpp_out=/tmp proto/protocol.proto && g++ -std=c++20 -O2 -I include/server -I /tmp test/login_prefetch_bench.cc src/server/PlayerDataManager.cc src/server/PlayerActors.cc src/server/PlayerLoader.cc src/server/PlayerCache.cc src/server/PlayerRecord.cc src/server/PlayerScripts.cc src/server/UidFilter.cc src/server/RedisBatcher.cc src/server/AsyncRedis.cc src/server/KafkaPublisher.cc src/server/SpillLog.cc src/server/PlayerEventLog.cc src/server/MySQLBatchWriter.cc src/server/ThreadPool.cc src/server/TimerWheel.cc /tmp/protocol.pb.cc -lredis++ -lhiredis -lcppkafka -lrdkafka -lprotobuf -lpthread -o login_prefetch_bench
+#include "PlayerDataManager.h"
+#include "UserDatamodel.h"
+#include "Usermodel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+    const int kFirstUid = 9000000;
+    const int kPlayers = 400; // 每一轮的玩家数（两轮使用不同的 uid，L1 都是冷的）
+    const int kConcurrentLogins = 8;
+    const auto kMySQLLatency = std::chrono::milliseconds(5); // 建连 + 查询
+    const auto kClientGap = std::chrono::milliseconds(20);
+    const int kRedisPercent = 70; // 其余玩家的 Redis 记录已过期，需要查 MySQL
+    const int kDisconnectPercent = 10;
+
+    std::atomic<size_t> db_queries = 0;
+
+    msg::PlayerAttr make_player(int uid)
+    {
+        msg::PlayerAttr player;
+        player.set_uid(uid);
+        player.set_level(1);
+        player.set_hp(100);
+        player.set_mp(50);
+        player.set_coin(1000);
+        return player;
+    }
+
+    bool in_redis(int uid)
+    {
+        return (uid - kFirstUid) % 100 < kRedisPercent;
+    }
+
+    bool disconnects(int uid)
+    {
+        return (uid - kFirstUid) * 7 % 100 < kDisconnectPercent;
+    }
+
+    double percentile(std::vector<double> &samples, double p)
+    {
+        if (samples.empty())
+            return 0;
+        std::sort(samples.begin(), samples.end());
+        return samples[std::min(samples.size() - 1, static_cast<size_t>(p * samples.size()))];
+    }
+}
+
+// 模拟表：bench 的每个 uid 都存在
+UserDatamodel::UserDatamodel() {}
+
+UserDatamodel &UserDatamodel::instance()
+{
+    static UserDatamodel instance;
+    return instance;
+}
+
+bool UserDatamodel::QueryUserData(msg::PlayerAttr &playerdata, bool *not_found)
+{
+    db_queries++;
+    std::this_thread::sleep_for(kMySQLLatency);
+    playerdata = make_player(playerdata.uid());
+    if (not_found)
+        *not_found = false;
+    return true;
+}
+
+bool UserDatamodel::QueryUserDataBatch(const std::vector<int> &uids, std::vector<msg::PlayerAttr> &out)
+{
+    db_queries++;
+    std::this_thread::sleep_for(kMySQLLatency);
+    for (int uid : uids)
+    {
+        out.push_back(make_player(uid));
+    }
+    return true;
+}
+
+bool UserDatamodel::InsertUserData(msg::PlayerAttr &playerdata)
+{
+    return true;
+}
+
+bool UserDatamodel::UpsertUserDataBatch(const std::vector<msg::PlayerAttr> &players)
+{
+    return true;
+}
+
+bool UserDatamodel::LoadUserDataRange(int after_uid, int limit, std::vector<msg::PlayerAttr> &out)
+{
+    return true;
+}
+
+Usermodel &Usermodel::getinstance()
+{
+    static Usermodel instance;
+    return instance;
+}
+
+bool Usermodel::loadUids(int after_uid, int limit, std::vector<int> &out)
+{
+    for (int uid = std::max(after_uid + 1, kFirstUid); uid < kFirstUid + 2 * kPlayers && out.size() < static_cast<size_t>(limit); ++uid)
+    {
+        out.push_back(uid);
+    }
+    return true;
+}
+
+// 一轮登录：每个线程依次登录自己的玩家，返回查看背包的延迟（毫秒）
+static std::vector<double> run_logins(int first_uid, bool prefetch)
+{
+    PlayerDataManager &manager = PlayerDataManager::getInstance();
+    std::mutex mtx;
+    std::vector<double> latencies;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kConcurrentLogins; ++t)
+    {
+        threads.emplace_back([&, t]
+                             {
+            for (int uid = first_uid + t; uid < first_uid + kPlayers; uid += kConcurrentLogins)
+            {
+                if (prefetch)
+                    manager.prefetchPlayer(uid);
+                if (disconnects(uid))
+                {
+                    manager.cancelPrefetch(uid);
+                    continue;
+                }
+                std::this_thread::sleep_for(kClientGap);
+
+                auto start = Clock::now();
+                std::promise<bool> loaded;
+                manager.getPlayerAsync(uid, [&loaded](std::shared_ptr<msg::PlayerAttr> player)
+                                       { loaded.set_value(player != nullptr); });
+                if (!loaded.get_future().get())
+                    std::cerr << "玩家 " << uid << " 加载失败" << std::endl;
+                double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+                std::lock_guard<std::mutex> lock(mtx);
+                latencies.push_back(ms);
+            } });
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    return latencies;
+}
+
+int main()
+{
+    sw::redis::ConnectionOptions redis_opts;
+    redis_opts.host = "127.0.0.1";
+    redis_opts.port = 6379;
+    sw::redis::Redis redis(redis_opts);
+    auto reset_keys = [&redis]
+    {
+        for (int uid = kFirstUid; uid < kFirstUid + 2 * kPlayers; ++uid)
+        {
+            redis.del("player:" + std::to_string(uid));
+        }
+    };
+    reset_keys();
+    for (int uid = kFirstUid; uid < kFirstUid + 2 * kPlayers; ++uid)
+    {
+        if (in_redis(uid))
+        {
+            RedisBatcher::Hash fields = PlayerRecord::toHash(make_player(uid));
+            redis.hset("player:" + std::to_string(uid), fields.begin(), fields.end());
+        }
+    }
+
+    // 与 main.cc 相同的装配：异步 Redis 先于线程池构造，退出前解除绑定
+    boost::asio::io_context io;
+    auto work = boost::asio::make_work_guard(io);
+    std::thread io_thread([&io]
+                          { io.run(); });
+    PlayerDataManager &manager = PlayerDataManager::getInstance();
+    {
+        AsyncRedis async_redis(io, "127.0.0.1", 6379);
+        {
+            ThreadPool pool(4);
+            manager.bindWorkerPool(pool);
+            async_redis.start();
+            manager.bindAsyncRedis(&async_redis);
+            manager.loadScripts();
+            manager.loadKnownUids();
+
+            size_t queries = db_queries;
+            std::vector<double> cold = run_logins(kFirstUid, false);
+            size_t cold_queries = db_queries - queries;
+            queries = db_queries;
+            std::vector<double> warm = run_logins(kFirstUid + kPlayers, true);
+            size_t warm_queries = db_queries - queries;
+
+            std::cout << "登录 " << kPlayers << " 个玩家（" << kRedisPercent << "% 在 Redis 中，"
+                      << kDisconnectPercent << "% 登录后立即断开），" << kConcurrentLogins << " 个并发登录线程" << std::endl;
+            std::cout << "无预取：第一次查看背包 p50 " << percentile(cold, 0.5) << " ms，p99 " << percentile(cold, 0.99)
+                      << " ms，MySQL 查询 " << cold_queries << " 次" << std::endl;
+            std::cout << "有预取：第一次查看背包 p50 " << percentile(warm, 0.5) << " ms，p99 " << percentile(warm, 0.99)
+                      << " ms，MySQL 查询 " << warm_queries << " 次" << std::endl;
+        }
+        // 线程池已析构（排队的任务已执行完），解除绑定后才析构异步客户端
+        manager.bindAsyncRedis(nullptr);
+        manager.unbindWorkerPool();
+    }
+    work.reset();
+    io.stop();
+    io_thread.join();
+    reset_keys();
+    return 0;
+}
@@ -0,0 +1,119 @@
+// 组提交测试：8 个线程模拟 2000 次下线落盘（500 个玩家），写入合并成少量批次，
+// 每个 future 都在所在批次写出后完成，每个玩家写出的是最后一次提交的状态；
+// 写入失败时回调在写入线程上收到 false（下线落盘不在工作线程上等待）。
+// 用测试内的 UserDatamodel 替换 MySQL 写入（不链接 UserDatamodel.cc）
+// 编译：protoc -I proto --cpp_out=/tmp proto/protocol.proto && g++ -std=c++20 -O2 -I include/server -I /tmp test/mysql_batch_writer_test.cc src/server/MySQLBatchWriter.cc /tmp/protocol.pb.cc -lprotobuf -lpthread -o mysql_batch_writer_test
+#include "MySQLBatchWriter.h"
+#include "UserDatamodel.h"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    std::mutex db_mtx;
+    std::unordered_map<int, int> db_exp; // 模拟表：uid -> exp
+    std::atomic<size_t> db_calls = 0;
+    std::atomic<bool> db_fail = false;
+}
+
+UserDatamodel::UserDatamodel() {}
+
+UserDatamodel &UserDatamodel::instance()
+{
+    static UserDatamodel instance;
+    return instance;
+}
+
+bool UserDatamodel::UpsertUserDataBatch(const std::vector<msg::PlayerAttr> &players)
+{
+    db_calls++;
+    std::this_thread::sleep_for(std::chrono::milliseconds(2)); // 模拟一次事务提交
+    if (db_fail)
+        return false;
+    std::lock_guard<std::mutex> lock(db_mtx);
+    for (const msg::PlayerAttr &player : players)
+    {
+        db_exp[player.uid()] = player.exp();
+    }
+    return true;
+}
+
+int main()
+{
+    const int kThreads = 8;
+    const int kPerThread = 250;
+    const int kPlayers = 500;
+
+    MySQLBatchWriter::Options options;
+    options.interval = std::chrono::milliseconds(20);
+    options.max_batch = 200;
+    MySQLBatchWriter writer(options);
+
+    // 每个线程负责自己的一组玩家，同一玩家的提交有先后，最后一次的 exp 最大
+    std::atomic<int> failed = 0;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t)
+    {
+        threads.emplace_back([&, t]
+                             {
+            std::vector<std::future<bool>> results;
+            for (int i = 0; i < kPerThread; ++i)
+            {
+                msg::PlayerAttr player;
+                player.set_uid(t * (kPlayers / kThreads) + i % (kPlayers / kThreads));
+                player.set_exp(i);
+                results.push_back(writer.submit(player));
+            }
+            for (auto &result : results)
+            {
+                if (!result.get())
+                    failed++;
+            } });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    // 每个玩家写出的是最后一次提交的 exp
+    int wrong = 0;
+    {
+        std::lock_guard<std::mutex> lock(db_mtx);
+        for (int t = 0; t < kThreads; ++t)
+        {
+            int players = kPlayers / kThreads;
+            for (int j = 0; j < players; ++j)
+            {
+                int last = (kPerThread - 1) - (kPerThread - 1 - j) % players;
+                auto it = db_exp.find(t * players + j);
+                if (it == db_exp.end() || it->second != last)
+                    wrong++;
+            }
+        }
+    }
+
+    // 写入失败时回调在写入线程上收到 false
+    db_fail = true;
+    msg::PlayerAttr player;
+    player.set_uid(1);
+    std::promise<bool> callback;
+    std::thread::id caller = std::this_thread::get_id();
+    writer.submit(player, [&](bool ok)
+                  { callback.set_value(!ok && std::this_thread::get_id() != caller); });
+    bool reported = callback.get_future().get();
+
+    MySQLBatchWriter::Stats s = writer.stats();
+    std::cout << s.submitted << " 次写入 -> " << s.flushes << " 批 / " << s.rows << " 行，最大一批 " << s.max_rows
+              << " 行，平均耗时 " << s.total_us / s.flushes << "us，最长 " << s.max_us << "us" << std::endl;
+    std::cout << "失败的 future: " << failed << "，状态错误的玩家: " << wrong << "，失败是否通知: " << reported << std::endl;
+    bool ok = failed == 0 && wrong == 0 && reported && s.flushes < s.submitted / 5 && s.max_rows <= kPlayers &&
+              s.failed_flushes == 1 && s.pending == 0;
+    std::cout << (ok ? "PASS" : "FAIL") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,108 @@
+// MySQL 连接池基准测试：登录（按 uid 查 User 表并校验密码）的每秒次数，每次新建连接（旧实现）与连接池
+// 需要本机 MySQL（DB.h 中的配置），先注册 kUsers 个测试账号
+// 编译：g++ -std=c++20 -O2 -I include/server test/mysql_pool_bench.cc src/server/DB.cc src/server/Usermodel.cc -lmysqlclient -lpthread -o mysql_pool_bench
+#include "DB.h"
+#include "Usermodel.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+    const int kThreads = 8; // 并发登录的工作线程
+    const int kUsers = 200;
+    const int kLoginsPerThread = 500;
+    const char *const kPassword = "bench_pw";
+
+    // 旧实现：每次登录 mysql_init + mysql_real_connect + set names + 查询 + mysql_close
+    bool login_without_pool(int uid)
+    {
+        MYSQL *conn = mysql_init(nullptr);
+        if (!mysql_real_connect(conn, server.c_str(), user.c_str(), password.c_str(), dbname.c_str(), 3306, nullptr, 0))
+        {
+            mysql_close(conn);
+            return false;
+        }
+        mysql_query(conn, "set names gbk");
+        char sql[1024] = {0};
+        snprintf(sql, sizeof sql, "SELECT * FROM User WHERE uid=%d", uid);
+        bool ok = false;
+        if (mysql_query(conn, sql) == 0)
+        {
+            MYSQL_RES *res = mysql_use_result(conn);
+            MYSQL_ROW row = mysql_fetch_row(res);
+            ok = row && std::string(row[2]) == kPassword;
+            mysql_free_result(res);
+        }
+        mysql_close(conn);
+        return ok;
+    }
+
+    template <typename F>
+    void run(const char *name, const std::vector<int> &uids, F &&login)
+    {
+        std::atomic<int> failed = 0;
+        Clock::time_point start = Clock::now();
+        std::vector<std::thread> threads;
+        for (int t = 0; t < kThreads; ++t)
+        {
+            threads.emplace_back([&, t]
+                                 {
+                for (int i = 0; i < kLoginsPerThread; ++i)
+                {
+                    if (!login(uids[(t * kLoginsPerThread + i) % uids.size()]))
+                        failed++;
+                } });
+        }
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        int total = kThreads * kLoginsPerThread;
+        std::cout << name << "：" << total << " 次登录用时 " << seconds << "s，" << static_cast<long long>(total / seconds)
+                  << " 次/秒，失败 " << failed << std::endl;
+    }
+}
+
+int main()
+{
+    MySQLPool::Options options;
+    options.min_size = kThreads;
+    options.max_size = kThreads;
+    MySQLPool::instance().configure(options);
+
+    std::vector<int> uids;
+    for (int i = 0; i < kUsers; ++i)
+    {
+        GameUser account;
+        account.setname("bench_" + std::to_string(i));
+        account.setpaswd(kPassword);
+        if (Usermodel::getinstance().zhuce(account))
+            uids.push_back(account.clientid());
+    }
+    if (uids.empty())
+    {
+        std::cerr << "注册测试账号失败，检查 MySQL 配置" << std::endl;
+        return 1;
+    }
+
+    run("每次新建连接", uids, login_without_pool);
+    run("连接池", uids, [](int uid)
+        {
+        GameUser account;
+        account.setid(uid);
+        account.setpaswd(kPassword);
+        return Usermodel::getinstance().Login(account); });
+
+    MySQLPool::Stats stats = MySQLPool::instance().stats();
+    std::cout << "连接池：" << stats.total << " 个连接，累计建立 " << stats.created << "，等待 " << stats.waits
+              << " 次，超时 " << stats.timeouts << " 次" << std::endl;
+    return 0;
+}
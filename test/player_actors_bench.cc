@@ -0,0 +1,129 @@
+// 玩家邮箱竞争基准：100k 个玩家被多个线程并发 updatePlayerAttr（只修改内存中的属性，隔离加锁/排队本身的开销），
+// 对比原来的 player_mutex_map_（全局 mtx_map_ + 每个 uid 一个 shared_ptr<mutex>，永不回收）与 PlayerActors::call。
+// 场景：uniform 为随机玩家；hot 为所有线程集中修改少数热点玩家（同一玩家的操作真正发生排队）
+// 编译：g++ -std=c++20 -O2 -I include/server test/player_actors_bench.cc src/server/PlayerActors.cc src/server/ThreadPool.cc src/server/TimerWheel.cc -lpthread -o player_actors_bench
+#include "PlayerActors.h"
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    const int kPlayers = 100000;
+    const int kThreads = 16;
+    const int kOpsPerThread = 200000;
+    const int kHotPlayers = 8;
+
+    // 原实现：全局锁保护的 uid -> mutex 表
+    class MutexMap
+    {
+    public:
+        template <typename F>
+        void run(int uid, F &&f)
+        {
+            std::shared_ptr<std::mutex> player_mutex;
+            {
+                std::lock_guard<std::mutex> lock(mtx_map_);
+                if (player_mutex_map_.find(uid) == player_mutex_map_.end())
+                    player_mutex_map_.emplace(uid, std::make_shared<std::mutex>());
+                player_mutex = player_mutex_map_[uid];
+            }
+            std::lock_guard<std::mutex> lock(*player_mutex);
+            f();
+        }
+        size_t size() const
+        {
+            return player_mutex_map_.size();
+        }
+
+    private:
+        std::mutex mtx_map_;
+        std::unordered_map<int, std::shared_ptr<std::mutex>> player_mutex_map_;
+    };
+
+    // 每个线程预先生成 uid 序列，不把随机数开销算进去
+    std::vector<std::vector<int>> make_uids(int players)
+    {
+        std::vector<std::vector<int>> uids(kThreads);
+        for (int t = 0; t < kThreads; ++t)
+        {
+            std::mt19937 rng(t);
+            std::uniform_int_distribution<int> dist(1, players);
+            uids[t].reserve(kOpsPerThread);
+            for (int i = 0; i < kOpsPerThread; ++i)
+            {
+                uids[t].push_back(dist(rng));
+            }
+        }
+        return uids;
+    }
+
+    // 模拟 updatePlayerAttr 在 L1 中修改一个字段；attrs 只在该玩家串行化的区域内修改
+    template <typename Serialize>
+    double run(const std::vector<std::vector<int>> &uids, std::vector<long long> &attrs, Serialize serialize)
+    {
+        auto start = Clock::now();
+        std::vector<std::thread> threads;
+        for (int t = 0; t < kThreads; ++t)
+        {
+            threads.emplace_back([&, t]
+                                 {
+                for (int uid : uids[t])
+                {
+                    serialize(uid, [&]
+                              { attrs[uid]++; });
+                } });
+        }
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    bool check(const std::vector<long long> &attrs)
+    {
+        long long total = 0;
+        for (long long value : attrs)
+        {
+            total += value;
+        }
+        return total == static_cast<long long>(kThreads) * kOpsPerThread;
+    }
+}
+
+int main()
+{
+    std::cout << kThreads << " 个线程，每个线程 " << kOpsPerThread << " 次更新，硬件线程数 "
+              << std::thread::hardware_concurrency() << std::endl;
+    bool ok = true;
+    for (int players : {kPlayers, kHotPlayers})
+    {
+        std::vector<std::vector<int>> uids = make_uids(players);
+
+        std::vector<long long> map_attrs(players + 1, 0);
+        MutexMap mutex_map;
+        double map_ms = run(uids, map_attrs, [&](int uid, auto &&f)
+                            { mutex_map.run(uid, f); });
+
+        std::vector<long long> actor_attrs(players + 1, 0);
+        PlayerActors actors;
+        double actor_ms = run(uids, actor_attrs, [&](int uid, auto &&f)
+                              { actors.call(uid, f); });
+
+        ok = ok && check(map_attrs) && check(actor_attrs) && actors.size() == 0;
+        std::cout << (players == kPlayers ? "[uniform] " : "[hot] ") << players << " 个玩家：mutex 表 " << map_ms
+                  << "ms（保留 " << mutex_map.size() << " 个锁），邮箱 " << actor_ms << "ms（保留 " << actors.size()
+                  << " 个邮箱）" << std::endl;
+    }
+    std::cout << (ok ? "PASS" : "FAIL") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,259 @@
+// 玩家邮箱测试：
+// 1. 单线程线程池上先 post 再 call 同一玩家：post 的处理任务排在 call 之后，call 不能在它上面等待
+// 2. 多线程混合 call/post（含嵌套 call）：每个玩家的消息按投递顺序执行、计数准确，结束后邮箱全部回收
+// 3. post_async：I/O 期间邮箱保持占用但不占用工作线程，之后的消息在 done 之后按顺序执行；
+//    另一个线程模拟 io 线程乱序完成，与 call/post 混合时每个玩家的操作仍然串行、按顺序
+// 编译：g++ -std=c++20 -O2 -I include/server test/player_actors_test.cc src/server/PlayerActors.cc src/server/ThreadPool.cc src/server/TimerWheel.cc -lpthread -o player_actors_test
+#include "PlayerActors.h"
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // post 之后在同一个工作线程上 call 同一玩家
+    bool post_then_call()
+    {
+        ThreadPool pool(1);
+        PlayerActors actors;
+        actors.bind(&pool);
+        std::vector<int> order;
+        std::promise<void> done;
+        // 先占住工作线程，保证两个任务都入队后才执行：post 的处理任务排在 call 之后
+        std::promise<void> gate;
+        std::shared_future<void> opened = gate.get_future().share();
+        pool.enqueue([opened]
+                     { opened.wait(); });
+        pool.enqueue([&]
+                     { actors.post(42, [&]
+                                   { order.push_back(1); }); });
+        pool.enqueue([&]
+                     {
+            actors.call(42, [&]
+                        { order.push_back(2); });
+            done.set_value(); });
+        gate.set_value();
+        if (done.get_future().wait_for(std::chrono::seconds(2)) != std::future_status::ready)
+        {
+            std::cout << "post 后 call 同一玩家卡死" << std::endl;
+            std::_Exit(1); // 工作线程卡死，线程池无法正常析构
+        }
+        // 等排在后面的处理任务执行完再检查回收
+        std::promise<void> drained;
+        pool.enqueue([&]
+                     { drained.set_value(); });
+        drained.get_future().wait();
+        bool ok = order == std::vector<int>{1, 2} && actors.size() == 0;
+        std::cout << "post 后 call：执行顺序 " << (order == std::vector<int>{1, 2} ? "正确" : "错误")
+                  << "，剩余邮箱 " << actors.size() << std::endl;
+        return ok;
+    }
+
+    // 多线程混合 call/post
+    bool mixed()
+    {
+        const int kThreads = 8;
+        const int kUids = 64;
+        const int kOps = 20000;
+
+        ThreadPool pool(4);
+        PlayerActors actors;
+        actors.bind(&pool);
+        // 每个玩家的计数只在其邮箱内修改，不加锁；乱序或并发执行会被 TSAN 或计数发现
+        std::vector<long long> counters(kUids, 0);
+        std::atomic<int> posted = 0;
+        std::vector<std::thread> threads;
+        for (int t = 0; t < kThreads; ++t)
+        {
+            threads.emplace_back([&, t]
+                                 {
+                for (int i = 0; i < kOps; ++i)
+                {
+                    int uid = (t * 7 + i) % kUids;
+                    if (i % 3 == 0)
+                    {
+                        posted++;
+                        actors.post(uid, [&, uid]
+                                    { counters[uid]++; });
+                    }
+                    else
+                    {
+                        actors.call(uid, [&]
+                                    {
+                            counters[uid]++;
+                            // 嵌套调用同一玩家直接执行
+                            actors.call(uid, [&]
+                                        { counters[uid]++; }); });
+                    }
+                } });
+        }
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+        // 等所有 post 执行完：对每个玩家 call 一次，排在之前的消息之后
+        long long total = 0;
+        for (int uid = 0; uid < kUids; ++uid)
+        {
+            total += actors.call(uid, [&]
+                                 { return counters[uid]; });
+        }
+        long long expected = posted + 2LL * (kThreads * kOps - posted);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100)); // 已安排的处理任务执行完后才回收
+        std::cout << "混合 call/post：计数 " << total << "/" << expected << "，剩余邮箱 " << actors.size() << std::endl;
+        return total == expected && actors.size() == 0;
+    }
+
+    // 挂起的邮箱不占用唯一的工作线程
+    bool async_suspend()
+    {
+        ThreadPool pool(1);
+        PlayerActors actors;
+        actors.bind(&pool);
+        std::vector<int> order; // 只在玩家 1 的邮箱内修改
+        std::promise<PlayerActors::Done> started;
+        actors.post_async(1, [&](PlayerActors::Done done)
+                          {
+            order.push_back(1);
+            started.set_value(std::move(done)); });
+        actors.post(1, [&]
+                    { order.push_back(2); });
+        PlayerActors::Done done = started.get_future().get();
+        // 玩家 1 等待 I/O 期间，唯一的工作线程仍能处理其他玩家
+        std::promise<void> other;
+        actors.post(2, [&]
+                    { other.set_value(); });
+        bool free = other.get_future().wait_for(std::chrono::seconds(2)) == std::future_status::ready;
+        // call 等到 done 之后，排在已投递的消息之后执行
+        std::thread caller([&]
+                           { actors.call(1, [&]
+                                         { order.push_back(3); }); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        done();
+        caller.join();
+        std::promise<void> drained;
+        pool.enqueue([&]
+                     { drained.set_value(); });
+        drained.get_future().wait();
+        bool ok = free && order == std::vector<int>{1, 2, 3} && actors.size() == 0;
+        std::cout << "post_async 挂起：工作线程" << (free ? "未被占用" : "被占用")
+                  << "，执行顺序 " << (order == std::vector<int>{1, 2, 3} ? "正确" : "错误")
+                  << "，剩余邮箱 " << actors.size() << std::endl;
+        return ok;
+    }
+
+    // 异步操作由模拟的 io 线程乱序完成，与 call/post 混合
+    bool async_mixed()
+    {
+        const int kThreads = 4;
+        const int kUids = 32;
+        const int kOps = 5000;
+
+        ThreadPool pool(4);
+        PlayerActors actors;
+        actors.bind(&pool);
+        // 每个玩家的下一个序号：异步操作在发起时检查、在完成时递增，中间有别的操作插入会被发现
+        std::vector<long long> counters(kUids, 0);
+        std::atomic<int> errors = 0;
+        std::atomic<long long> issued = 0;
+
+        std::mutex io_mtx;
+        std::vector<PlayerActors::Done> io_queue;
+        std::atomic<bool> stop = false;
+        std::thread io([&]
+                       {
+            unsigned seed = 1;
+            while (!stop || !io_queue.empty())
+            {
+                std::vector<PlayerActors::Done> ready;
+                {
+                    std::lock_guard<std::mutex> lock(io_mtx);
+                    ready.swap(io_queue);
+                }
+                // 倒序完成，模拟不同连接的回复先后不定
+                for (auto it = ready.rbegin(); it != ready.rend(); ++it)
+                {
+                    (*it)();
+                }
+                seed = seed * 1103515245 + 12345;
+                std::this_thread::sleep_for(std::chrono::microseconds(seed % 50));
+            } });
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < kThreads; ++t)
+        {
+            threads.emplace_back([&, t]
+                                 {
+                for (int i = 0; i < kOps; ++i)
+                {
+                    int uid = (t * 5 + i) % kUids;
+                    issued++;
+                    switch (i % 4)
+                    {
+                    case 0:
+                        actors.post(uid, [&, uid]
+                                    { counters[uid]++; });
+                        break;
+                    case 1:
+                        actors.call(uid, [&, uid]
+                                    { counters[uid]++; });
+                        break;
+                    case 2:
+                        // 偶尔在返回之前就完成
+                        actors.post_async(uid, [&, uid, i](PlayerActors::Done done)
+                                          {
+                            long long seen = counters[uid];
+                            if (i % 8 == 2)
+                            {
+                                counters[uid]++;
+                                done();
+                                return;
+                            }
+                            std::lock_guard<std::mutex> lock(io_mtx);
+                            io_queue.push_back([&, uid, seen, done]
+                                               {
+                                if (counters[uid] != seen)
+                                    errors++;
+                                counters[uid]++;
+                                done(); }); });
+                        break;
+                    default:
+                        actors.post(uid, [&, uid]
+                                    { counters[uid]++; });
+                    }
+                } });
+        }
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+        long long total = 0;
+        for (int uid = 0; uid < kUids; ++uid)
+        {
+            total += actors.call(uid, [&]
+                                 { return counters[uid]; });
+        }
+        stop = true;
+        io.join();
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        std::cout << "post_async 混合：计数 " << total << "/" << issued.load() << "，插队 " << errors.load()
+                  << "，剩余邮箱 " << actors.size() << std::endl;
+        return total == issued && errors == 0 && actors.size() == 0;
+    }
+}
+
+int main()
+{
+    bool ok = post_then_call();
+    ok = mixed() && ok;
+    ok = async_suspend() && ok;
+    ok = async_mixed() && ok;
+    std::cout << (ok ? "PASS" : "FAIL") << std::endl;
+    return ok ? 0 : 1;
+}
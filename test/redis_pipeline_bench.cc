@@ -0,0 +1,105 @@
+// Redis 批量访问层基准测试（需要本地 redis-server 127.0.0.1:6379）
+// 编译：g++ -std=c++20 -O2 -I include/server test/redis_pipeline_bench.cc src/server/RedisBatcher.cc -lredis++ -lhiredis -lpthread -o redis_pipeline_bench
+#include "RedisBatcher.h"
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsed_ms(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+int main()
+{
+    const int kPlayers = 10000; // 玩家数
+    const int kRoomSize = 10;   // 一个房间的玩家数
+    const int kThreads = 16;    // 并发线程数
+
+    sw::redis::ConnectionOptions redis_opts;
+    redis_opts.host = "127.0.0.1";
+    redis_opts.port = 6379;
+    sw::redis::ConnectionPoolOptions pool_opts;
+    pool_opts.size = 8;
+    auto redis = std::make_shared<sw::redis::Redis>(redis_opts, pool_opts);
+    RedisBatcher batcher(redis);
+
+    // 准备数据
+    std::vector<std::string> keys;
+    for (int uid = 0; uid < kPlayers; ++uid)
+    {
+        keys.push_back("bench:player:" + std::to_string(uid));
+    }
+    RedisBatcher::Hash fields = {{"level", "1"}, {"exp", "0"}, {"hp", "100"}, {"mp", "50"}, {"coin", "1000"}, {"x", "0.000000"}, {"y", "0.000000"}, {"z", "0.000000"}};
+    std::vector<std::pair<std::string, RedisBatcher::Hash>> items;
+    for (const std::string &key : keys)
+    {
+        items.emplace_back(key, fields);
+    }
+    auto start = Clock::now();
+    batcher.hsetMany(items);
+    std::cout << "写入 " << kPlayers << " 个玩家（pipeline）: " << elapsed_ms(start) << " ms" << std::endl;
+
+    // 1. 房间开局：逐个 exists + hgetall（原实现） vs 一次 pipeline
+    start = Clock::now();
+    for (int i = 0; i < kPlayers; ++i)
+    {
+        if (redis->exists(keys[i]))
+        {
+            std::unordered_map<std::string, std::string> data;
+            redis->hgetall(keys[i], std::inserter(data, data.end()));
+        }
+    }
+    double serial = elapsed_ms(start);
+
+    start = Clock::now();
+    for (int i = 0; i < kPlayers; i += kRoomSize)
+    {
+        std::vector<std::string> room(keys.begin() + i, keys.begin() + i + kRoomSize);
+        batcher.hgetallMany(room);
+    }
+    double batched = elapsed_ms(start);
+    std::cout << "房间开局（" << kRoomSize << " 人）逐个读取: " << serial / (kPlayers / kRoomSize) << " ms/房间，"
+              << "pipeline: " << batched / (kPlayers / kRoomSize) << " ms/房间" << std::endl;
+
+    // 2. 多线程并发单玩家读取：直接访问 vs 共享 flush
+    auto run_threads = [&](auto &&read_one)
+    {
+        auto begin = Clock::now();
+        std::vector<std::thread> threads;
+        for (int t = 0; t < kThreads; ++t)
+        {
+            threads.emplace_back([&, t]
+                                 {
+                for (int i = t; i < kPlayers; i += kThreads)
+                    read_one(keys[i]); });
+        }
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+        return kPlayers / (elapsed_ms(begin) / 1000.0);
+    };
+    double direct_qps = run_threads([&](const std::string &key)
+                                    {
+        std::unordered_map<std::string, std::string> data;
+        redis->hgetall(key, std::inserter(data, data.end())); });
+    size_t flushes_before = batcher.flushCount();
+    size_t commands_before = batcher.commandCount();
+    double batched_qps = run_threads([&](const std::string &key)
+                                     { batcher.hgetall(key); });
+    size_t flushes = batcher.flushCount() - flushes_before;
+    size_t commands = batcher.commandCount() - commands_before;
+    std::cout << kThreads << " 线程并发读取 直接访问: " << direct_qps << " 次/秒，共享 flush: " << batched_qps
+              << " 次/秒（平均每次往返 " << (flushes ? double(commands) / flushes : 0) << " 条命令）" << std::endl;
+
+    for (const std::string &key : keys)
+    {
+        redis->del(key);
+    }
+    return 0;
+}
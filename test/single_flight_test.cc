@@ -0,0 +1,79 @@
+// single-flight 测试：1000 个并发请求同时未命中同一个玩家，只允许发生一次数据库查询。
+// 走的是 PlayerDataManager::getPlayer 使用的 PlayerLoader（合并 -> 玩家邮箱 -> 再查 L1 -> 加载并放入 L1）
+// 编译：protoc -I proto --cpp_out=/tmp proto/protocol.proto && g++ -std=c++20 -O2 -I include/server -I /tmp test/single_flight_test.cc src/server/PlayerLoader.cc src/server/PlayerCache.cc src/server/PlayerActors.cc src/server/ThreadPool.cc src/server/TimerWheel.cc /tmp/protocol.pb.cc -lprotobuf -lpthread -o single_flight_test
+#include "PlayerLoader.h"
+#include "PlayerActors.h"
+#include "PlayerCache.h"
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+int main()
+{
+    const int kCallers = 1000;
+    const int kUid = 10001;
+
+    ThreadPool pool(4);
+    PlayerActors actors;
+    actors.bind(&pool);
+    PlayerCache cache(1024 * 1024); // L1 初始为空（例如刚重启）
+    PlayerLoader loader(actors, cache);
+    std::atomic<int> db_queries = 0;
+
+    // 与 getPlayer 相同：L1 命中直接返回，否则经 PlayerLoader 加载（加载函数负责放入 L1）
+    auto get_player = [&](int uid) -> std::shared_ptr<msg::PlayerAttr>
+    {
+        auto playerdata = std::make_shared<msg::PlayerAttr>();
+        if (cache.get(uid, *playerdata))
+            return playerdata;
+        return loader.loadOnce(uid, [&]() -> std::shared_ptr<msg::PlayerAttr>
+                               {
+            db_queries++;
+            std::this_thread::sleep_for(std::chrono::milliseconds(50)); // 模拟一次数据库查询
+            playerdata->set_uid(uid);
+            playerdata->set_level(7);
+            cache.put(*playerdata);
+            return playerdata; });
+    };
+
+    // 所有线程就绪后同时发起请求
+    std::mutex start_mtx;
+    std::condition_variable start_cv;
+    bool go = false;
+    std::atomic<int> wrong = 0;
+    std::vector<std::thread> callers;
+    for (int i = 0; i < kCallers; ++i)
+    {
+        callers.emplace_back([&]
+                             {
+            {
+                std::unique_lock<std::mutex> lock(start_mtx);
+                start_cv.wait(lock, [&]
+                              { return go; });
+            }
+            auto value = get_player(kUid);
+            if (!value || value->uid() != kUid || value->level() != 7)
+                wrong++; });
+    }
+    {
+        std::lock_guard<std::mutex> lock(start_mtx);
+        go = true;
+    }
+    start_cv.notify_all();
+    for (auto &caller : callers)
+    {
+        caller.join();
+    }
+
+    std::cout << kCallers << " 个并发未命中，数据库查询次数: " << db_queries << "，结果错误: " << wrong
+              << "，剩余在途加载: " << loader.inflight() << std::endl;
+    bool ok = db_queries == 1 && wrong == 0 && loader.inflight() == 0;
+    std::cout << (ok ? "PASS" : "FAIL") << std::endl;
+    return ok ? 0 : 1;
+}
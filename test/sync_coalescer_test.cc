@@ -0,0 +1,55 @@
+// 写合并测试：模拟刷经验（200 个玩家，每人每 20ms 一条更新，持续 2s），
+// 500ms 窗口合并后 MySQL 写入次数应比消息数少一个数量级，且每个玩家的最后一次更新都被写出
+// 编译：g++ -std=c++20 -O2 -I include/server test/sync_coalescer_test.cc src/server/SyncCoalescer.cc -o sync_coalescer_test
+#include "SyncCoalescer.h"
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <unordered_map>
+
+int main()
+{
+    const int kPlayers = 200;
+    const auto kInterval = std::chrono::milliseconds(20);
+    const auto kDuration = std::chrono::seconds(2);
+
+    size_t rows = 0;
+    std::unordered_map<int, int> last_update; // 每个玩家最后一条消息的序号
+    std::unordered_map<int, int> written;     // 写出时看到的序号
+    int seq = 0;
+    SyncCoalescer coalescer([&](const std::vector<int> &uids)
+                            {
+        rows += uids.size();
+        for (int uid : uids)
+        {
+            written[uid] = last_update[uid];
+        }
+        return true; },
+                            std::chrono::milliseconds(500), 500);
+
+    auto end = std::chrono::steady_clock::now() + kDuration;
+    while (std::chrono::steady_clock::now() < end)
+    {
+        for (int uid = 0; uid < kPlayers; ++uid)
+        {
+            last_update[uid] = ++seq;
+            coalescer.add(uid);
+        }
+        coalescer.maybeFlush();
+        std::this_thread::sleep_for(kInterval);
+    }
+    coalescer.flush();
+
+    SyncCoalescer::Stats stats = coalescer.stats();
+    bool complete = true;
+    for (int uid = 0; uid < kPlayers; ++uid)
+    {
+        complete = complete && written[uid] == last_update[uid];
+    }
+    std::cout << "消息数: " << stats.messages << "，MySQL 写入行数: " << rows << "，写出次数: " << stats.flushes
+              << "，合并比: " << (rows ? stats.messages / rows : 0) << "x" << std::endl;
+    bool ok = rows * 10 <= stats.messages && complete && coalescer.pending() == 0;
+    std::cout << (ok ? "PASS" : "FAIL") << std::endl;
+    return ok ? 0 : 1;
+}